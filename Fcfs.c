@@ -1,80 +1,160 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <time.h>
+#include "process_table.h"
+
+// Usage: ./Fcfs                 enter the processes by hand
+//        ./Fcfs TRACE_FILE      read "arrival burst" lines from a file
+//
+// A large trace can be made with e.g.
+//   awk 'BEGIN { srand(1); for (i = 0; i < 10000000; i++) print int(rand() * 5e8), 1 + int(rand() * 100) }' > trace.txt
+
+// FCFS over a table sorted by arrival: fills in wait and turnaround and
+// returns the completion time of the last process. 64-bit throughout, so
+// long traces cannot overflow.
+static long long fcfsSchedule(process_table *pt) {
+    long long currentTime = 0;
+    for (int i = 0; i < pt->count; i++) {
+        // If process arrives after current time, wait for it
+        if (currentTime < pt->arrival[i]) currentTime = pt->arrival[i];
+        pt->start[i] = currentTime;
+        currentTime += pt->burst[i];
+        pt_finish(pt, i, currentTime);
+    }
+    return currentTime;
+}
+
+static void printTotals(const pt_summary *wait, const pt_summary *turnaround, const pt_latency *latency) {
+    printf("\nAverage waiting time: %.2f\n", (float)wait->sum / wait->count);
+    printf("Average turnaround time: %.2f\n", (float)turnaround->sum / turnaround->count);
+    pt_print_summary("Waiting time", wait);
+    pt_print_summary("Turnaround time", turnaround);
+    printf("\n");
+    pt_print_latency(latency);
+}
+
+static void printStats(const process_table *pt) {
+    pt_summary wait = pt_summarize(pt->wait, pt->count);
+    pt_summary turnaround = pt_summarize(pt->turnaround, pt->count);
+    printTotals(&wait, &turnaround, pt->latency);
+}
+
+static double secondsSince(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Non-interactive mode. A trace that is already in arrival order is
+// scheduled while it is parsed and never stored: only the summaries and
+// the histograms see each process. At the first arrival out of order the
+// trace is loaded into a process table and radix sorted instead.
+static int runTrace(const char *path) {
+    workload_reader r;
+    pt_latency latency;
+    pt_summary wait = {0, 0, 0, 0, 0.0, 0.0}, turnaround = wait;
+    long long lastCompletion = 0;
+    int arrival, burst, priority;
+    int lastArrival = INT_MIN;
+    int sorted = 1;
+    struct timespec start, sortStart;
+    double sortSeconds = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    memset(&latency, 0, sizeof(latency));
+    workload_open(&r, path);
+    while (workload_next(&r, &arrival, &burst, &priority)) {
+        if (burst < 0) workload_error(&r, "burst time must not be negative");
+        if (arrival < lastArrival) {
+            sorted = 0;
+            break;
+        }
+        lastArrival = arrival;
+        // The same steps as fcfsSchedule and pt_finish, for one process
+        if (lastCompletion < arrival) lastCompletion = arrival;
+        long long waited = lastCompletion - arrival;
+        lastCompletion += burst;
+        pt_summary_add(&wait, waited);
+        pt_summary_add(&turnaround, waited + burst);
+        latency_hist_record(&latency.wait, waited);
+        latency_hist_record(&latency.turnaround, waited + burst);
+        latency_hist_record(&latency.response, waited);
+    }
+    workload_close(&r);
+
+    if (!sorted) {
+        process_table pt;
+        pt_init(&pt, 1 << 20);
+        pt_attach_latency(&pt, &latency);
+        pt_load(&pt, path, 0);
+        clock_gettime(CLOCK_MONOTONIC, &sortStart);
+        pt_sort_by(&pt, pt.arrival);
+        sortSeconds = secondsSince(&sortStart);
+        lastCompletion = fcfsSchedule(&pt);
+        wait = pt_summarize(pt.wait, pt.count);
+        turnaround = pt_summarize(pt.turnaround, pt.count);
+        pt_free(&pt);
+    }
+    double seconds = secondsSince(&start);
+
+    if (wait.count == 0) {
+        printf("No processes in '%s'\n", path);
+        return EXIT_FAILURE;
+    }
+
+    printf("FCFS Scheduling Results for %s:\n", path);
+    printf("Processes: %ld (%s)\n", wait.count,
+           sorted ? "already in arrival order, streamed without sorting" : "radix sorted by arrival");
+    printf("Completion of last process: %lld\n", lastCompletion);
+    printTotals(&wait, &turnaround, &latency);
+    printf("\nTime: %.3f s (sort %.3f s)\n", seconds, sortSeconds);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int n, i, arrival, burst;
+    process_table pt;
+    pt_latency latency;
+
+    if (argc == 2) return runTrace(argv[1]);
+    if (argc > 2) {
+        printf("Usage: %s [TRACE_FILE]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
 
-struct Process {
-    int id;
-    int arrivalTime;
-    int burstTime;
-    int waitingTime;
-    int turnaroundTime;
-    int completionTime;
-};
-
-int main() {
-    int n, i;
-    float avgWait = 0, avgTurnaround = 0;
-    
     printf("Enter the number of processes: ");
-    scanf("%d", &n);
-    
-    struct Process p[n];
-    
+    if (scanf("%d", &n) != 1 || n <= 0) {
+        printf("\nThe number of processes must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    pt_init(&pt, n);
+    pt_attach_latency(&pt, &latency);
     printf("\nEnter process details:\n");
     for(i = 0; i < n; i++) {
-        p[i].id = i + 1;
         printf("P%d arrival time: ", i + 1);
-        scanf("%d", &p[i].arrivalTime);
+        scanf("%d", &arrival);
         printf("P%d burst time: ", i + 1);
-        scanf("%d", &p[i].burstTime);
-    }
-    
-    // Sort by arrival time (FCFS)
-    for(i = 0; i < n - 1; i++) {
-        for(int j = 0; j < n - i - 1; j++) {
-            if(p[j].arrivalTime > p[j+1].arrivalTime) {
-                struct Process temp = p[j];
-                p[j] = p[j+1];
-                p[j+1] = temp;
-            }
-        }
-    }
-    
-    // Calculate completion, waiting, and turnaround times
-    int currentTime = 0;
-    
-    for(i = 0; i < n; i++) {
-        // If process arrives after current time, wait for it
-        if(currentTime < p[i].arrivalTime) {
-            currentTime = p[i].arrivalTime;
-        }
-        
-        p[i].waitingTime = currentTime - p[i].arrivalTime;
-        p[i].completionTime = currentTime + p[i].burstTime;
-        p[i].turnaroundTime = p[i].completionTime - p[i].arrivalTime;
-        
-        currentTime = p[i].completionTime;
+        scanf("%d", &burst);
+        pt_add(&pt, arrival, burst, 0);
     }
-    
+
+    // Sort by arrival time (FCFS), then calculate waiting and turnaround times
+    pt_sort_by(&pt, pt.arrival);
+    fcfsSchedule(&pt);
+
     // Display results
-    int totalWait = 0;
-    int totalTurnaround = 0;
-    
     printf("\nFCFS Scheduling Results:\n");
     printf("PID\tArrival\tBurst\tWait\tTurnaround\tCompletion\n");
-    
+
     for(i = 0; i < n; i++) {
-        totalWait += p[i].waitingTime;
-        totalTurnaround += p[i].turnaroundTime;
-        
-        printf("P%d\t%d\t%d\t%d\t%d\t\t%d\n", 
-               p[i].id, p[i].arrivalTime, p[i].burstTime, 
-               p[i].waitingTime, p[i].turnaroundTime, p[i].completionTime);
+        printf("P%d\t%d\t%d\t%lld\t%lld\t\t%lld\n",
+               pt.id[i], pt.arrival[i], pt.burst[i],
+               pt.wait[i], pt.turnaround[i], pt.arrival[i] + pt.turnaround[i]);
     }
-    
-    avgWait = (float)totalWait / n;
-    avgTurnaround = (float)totalTurnaround / n;
-    
-    printf("\nAverage waiting time: %.2f\n", avgWait);
-    printf("Average turnaround time: %.2f\n", avgTurnaround);
-    
+
+    printStats(&pt);
+    pt_free(&pt);
     return 0;
 }
@@ -1,99 +1,608 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "rr_queue.h"
+#include "rr_cycle.h"
+#include "process_table.h"
+#include "timeline.h"
 
-struct Process {
-    int id;
-    int burstTime;
-    int remainingTime;
-    int waitingTime;
-    int turnaroundTime;
-    int lastExecutionTime;
+// Usage: ./Round_robin                                 enter the processes by hand
+//        ./Round_robin TRACE_FILE QUANTUM [--switch COST] [--order] [--summary]
+//                     [--timeline FILE | --timeline-csv FILE] [--verify]
+//                                                      read "arrival burst" lines from a file;
+//                                                      --switch charges COST ticks per context
+//                                                      switch, --order prints every slice,
+//                                                      --summary skips the per-process table,
+//                                                      --timeline saves every slice as a
+//                                                      run-length-encoded Gantt timeline
+//                                                      (query it with timeline_query),
+//                                                      --verify reruns the trace one slice
+//                                                      at a time and checks the fast-forward
+//        ./Round_robin TRACE_FILE --sweep QUANTA [--switch COSTS] [--threads N]
+//                                                      simulate every quantum x switch cost
+//                                                      pair in parallel; lists are like
+//                                                      "1,2,4" or "1-64:4" (from-to:step)
+//
+// Build with -pthread.
+
+struct RoundRobinStats {
+    long slices;                // slices run one at a time
+    long fastForwards;          // times many slices were charged at once
+    long long slicesSkipped;    // slices covered by those fast-forwards
+    long long idleTime;
+    long long switches;         // dispatches of a process other than the last one run
+    long long switchTime;
 };
 
-int main() {
-    int n, i, timeQuantum;
-    float avgWait = 0, avgTurnaround = 0;
-    
-    printf("Enter the number of processes: ");
-    scanf("%d", &n);
-    
-    printf("Enter time quantum: ");
-    scanf("%d", &timeQuantum);
-    
-    struct Process p[n];
-    
-    printf("\nEnter process details:\n");
-    for(i = 0; i < n; i++) {
-        p[i].id = i + 1;
-        printf("P%d burst time: ", i + 1);
-        scanf("%d", &p[i].burstTime);
-        p[i].remainingTime = p[i].burstTime;
-        p[i].waitingTime = 0;
-        p[i].lastExecutionTime = 0; // Time when process last executed
-    }
-    
-    // Round Robin Simulation
-    int currentTime = 0;
+// Round robin without printing or a timeline, from event to event: a
+// process finishing, or an arrival joining the queue. The live processes
+// are an rr_cycle in dispatch order, each tagged with the pass of the
+// dispatcher in which it finishes (it needs ceil(burst / quantum) slices,
+// one per pass), so the next completion is the cycle's first finish. Every
+// slice before it is a full quantum, so its time and switch count are
+// closed-form, as is the first slice end at or after the next arrival. An
+// arrival joins the cycle just behind the dispatcher, which is the tail of
+// the ready queue. Each event is O(log n), so a trace costs O(n log n)
+// however long its bursts. The results are those of the slice-by-slice
+// loop below, which --verify checks.
+//
+// Start times are settled when the dispatcher reaches them: a process
+// joining the queue is first dispatched after every process ahead of it
+// has been dispatched once (all the live ones but a preempted process,
+// which queues behind it), a slice count known on arrival.
+static void settleRoundRobin(process_table *pt, int timeQuantum, int switchCost,
+                             struct RoundRobinStats *st) {
+    int n = pt->count;
+    const int *arrival = pt->arrival;
+    const int *burst = pt->burst;
+    long long q = timeQuantum, c = switchCost;
+    int *lastSlice = malloc(n * sizeof(int));               // length of the final slice
+    int *unstarted = malloc(n * sizeof(int));               // FIFO of processes not yet run...
+    long long *firstSlice = malloc(n * sizeof(long long));  // ...and the slice each runs first
+    if (lastSlice == NULL || unstarted == NULL || firstSlice == NULL) {
+        printf("Out of memory for %d processes\n", n);
+        exit(EXIT_FAILURE);
+    }
+    rr_cycle cycle;
+    long long currentTime = 0;
+    long long pass = 0;         // the dispatcher's pass over the cycle...
+    int rank = 0;               // ...and the rank it dispatches next
+    long long dispatched = 0;   // slices run so far
+    int unstartedHead = 0, unstartedTail = 0;
     int completed = 0;
-    int totalWait = 0;
-    int totalTurnaround = 0;
-    
-    printf("\nRound Robin Execution Order:\n");
-    
-    while(completed < n) {
-        int allIdle = 1; // Flag to detect idle CPU
-        
-        for(i = 0; i < n; i++) {
-            if(p[i].remainingTime > 0) {
-                allIdle = 0; // There's work to do
-                
-                // Calculate waiting time for this cycle
-                if(currentTime > p[i].lastExecutionTime) {
-                    p[i].waitingTime += currentTime - p[i].lastExecutionTime;
+    int next = 0;               // next process to arrive
+    int lastRun = -1;
+
+    memset(st, 0, sizeof(*st));
+    pt_reset_run(pt);
+    rr_cycle_init(&cycle, n);
+
+    while (completed < n) {
+        int m = rr_cycle_count(&cycle);
+        int preempted = 0;
+        if (m == 0) {
+            // Idle CPU: jump to the next arrival, which is dispatched first
+            if (currentTime < arrival[next]) {
+                st->idleTime += arrival[next] - currentTime;
+                currentTime = arrival[next];
+            }
+            rank = 0;
+        } else {
+            // Run up to the next completion, or to the end of the slice in
+            // which the next process arrives if that comes first. With
+            // several processes every slice is a switch, except the very
+            // first dispatch of the run; a lone process switches at most
+            // once. Slice j of the jump ends at base + j * step.
+            int doneRank;
+            int done = rr_cycle_first_finish(&cycle, &doneRank);
+            long long slices = (cycle.finish[done] - pass) * m + doneRank - rank + 1;
+            int everySwitch = m > 1;
+            int firstSwitch = lastRun >= 0 && (m > 1 || done != lastRun);
+            long long step = q + everySwitch * c;
+            long long base = currentTime + (firstSwitch - everySwitch) * c;
+            long long finishAt = base + (slices - 1) * step + everySwitch * c + lastSlice[done];
+            long long run = slices;
+            if (next < n && arrival[next] <= finishAt) {
+                long long k = (arrival[next] - base + step - 1) / step;
+                if (k < 1) k = 1;
+                if (k < slices) {
+                    run = k;
+                    preempted = 1;
                 }
-                
-                printf("Time %d-%d: P%d\n", 
-                       currentTime, 
-                       currentTime + (p[i].remainingTime < timeQuantum ? p[i].remainingTime : timeQuantum),
-                       p[i].id);
-                
-                // Execute process for quantum or remaining time
-                int executionTime = (p[i].remainingTime < timeQuantum) ? 
-                                    p[i].remainingTime : timeQuantum;
-                
-                currentTime += executionTime;
-                p[i].remainingTime -= executionTime;
-                p[i].lastExecutionTime = currentTime;
-                
-                // If process completed
-                if(p[i].remainingTime == 0) {
-                    completed++;
-                    p[i].turnaroundTime = currentTime;
-                    totalWait += p[i].waitingTime;
-                    totalTurnaround += p[i].turnaroundTime;
+            }
+
+            while (unstartedHead < unstartedTail && firstSlice[unstartedHead] <= dispatched + run) {
+                long long j = firstSlice[unstartedHead] - dispatched;
+                int p = unstarted[unstartedHead++];
+                pt->start[p] = j == slices ? finishAt - lastSlice[done] : base + j * step - q;
+            }
+            long long switches = firstSwitch + (run - 1) * everySwitch;
+            currentTime = preempted ? base + run * step : finishAt;
+            dispatched += run;
+            st->fastForwards++;
+            st->slicesSkipped += run;
+            st->switches += switches;
+            st->switchTime += switches * c;
+
+            long long at = rank + run - 1;     // the last slice's place from the pass start
+            pass += at / m;
+            if (preempted) {
+                lastRun = rr_cycle_at(&cycle, (int)(at % m));
+                rank = (int)(at % m) + 1;
+            } else {
+                rr_cycle_remove(&cycle, doneRank);
+                pt_finish(pt, done, currentTime);
+                completed++;
+                lastRun = done;
+                rank = doneRank;
+            }
+        }
+
+        // Arrivals join just behind the dispatcher, ahead of a preempted
+        // process, so their first pass is the next one (the current one
+        // when the CPU was idle)
+        while (next < n && arrival[next] <= currentTime) {
+            int p = next++;
+            long long slicesNeeded = (burst[p] + q - 1) / q;
+            lastSlice[p] = (int)(burst[p] - (slicesNeeded - 1) * q);
+            unstarted[unstartedTail] = p;
+            firstSlice[unstartedTail++] = dispatched + rr_cycle_count(&cycle) - preempted + 1;
+            if (m == 0) {
+                rr_cycle_insert(&cycle, rr_cycle_count(&cycle), p, pass + slicesNeeded - 1);
+            } else {
+                rr_cycle_insert(&cycle, rank - preempted, p, pass + slicesNeeded);
+                rank++;
+            }
+        }
+        if (rank >= rr_cycle_count(&cycle)) {
+            pass++;
+            rank = 0;
+        }
+    }
+    rr_cycle_free(&cycle);
+    free(lastSlice);
+    free(unstarted);
+    free(firstSlice);
+}
+
+// Round robin over a ring-buffer ready queue that holds only live
+// processes. When a slice ends, processes that arrived by then join the
+// queue ahead of the preempted one.
+//
+// Printing the order or writing a timeline costs a line per slice anyway,
+// so only those runs take this loop; the others go to settleRoundRobin.
+// Fast-forward: if every queued process has more than k quanta left and
+// nothing arrives during the next k rounds, the next k rounds run every
+// queued process for a full quantum in the same order. They are charged
+// at once, and the queue is left exactly as it was. It is tried once per
+// round, so the scan costs O(1) per slice.
+//
+// fastForward = 0 runs every slice one at a time, for --verify.
+//
+// Dispatching a process other than the one that ran last costs switchCost
+// ticks before its slice (the first dispatch is free). With a timeline,
+// every slice is added to it, fast-forwarded ones included; a lone process
+// is one record however many rounds it runs. The table must be
+// sorted by arrival time; it is only written in its per-run columns, so a
+// pt_fork of it can run on another thread.
+static void runRoundRobin(process_table *pt, int timeQuantum, int switchCost, int showOrder,
+                          int fastForward, timeline_writer *timeline, struct RoundRobinStats *st) {
+    int n = pt->count;
+    int *remaining = pt->remaining;
+    const int *arrival = pt->arrival;
+    rr_queue ready;
+    long long currentTime = 0;
+    int completed = 0;
+    int next = 0;               // next process to arrive
+    int untilCheck = 0;         // slices left before the next fast-forward attempt
+    int lastRun = -1;
+
+    if (fastForward && !showOrder && timeline == NULL) {
+        settleRoundRobin(pt, timeQuantum, switchCost, st);
+        return;
+    }
+    memset(st, 0, sizeof(*st));
+    pt_reset_run(pt);
+    rr_queue_init(&ready, n);
+
+    while (completed < n) {
+        // Idle CPU: jump to the next arrival
+        if (ready.count == 0 && currentTime < arrival[next]) {
+            st->idleTime += arrival[next] - currentTime;
+            currentTime = arrival[next];
+        }
+        while (next < n && arrival[next] <= currentTime) rr_push(&ready, next++);
+
+        if (untilCheck == 0) {
+            untilCheck = ready.count;
+            int minRemaining = remaining[rr_at(&ready, 0)];
+            for (int i = 1; i < ready.count; i++)
+                if (remaining[rr_at(&ready, i)] < minRemaining)
+                    minRemaining = remaining[rr_at(&ready, i)];
+
+            // With several processes every slice is a switch, except the
+            // very first dispatch of the run; a lone process switches at
+            // most once, on its first slice. fixed is the difference from
+            // k whole rounds: one switch more or one less.
+            int m = ready.count;
+            int firstSwitch = m == 1 && lastRun >= 0 && rr_at(&ready, 0) != lastRun;
+            int freeDispatch = m > 1 && lastRun < 0;
+            long long round = (long long)m * timeQuantum + (m > 1 ? (long long)m * switchCost : 0);
+            long long fixed = firstSwitch ? switchCost : freeDispatch ? -(long long)switchCost : 0;
+            long long k = (minRemaining - 1) / timeQuantum;
+            if (next < n && (arrival[next] - currentTime - 1 - fixed) / round < k)
+                k = (arrival[next] - currentTime - 1 - fixed) / round;
+            if (!fastForward) k = 0;
+            if (k > 0) {
+                // The p-th process in the queue first runs p slices (and
+                // their switches) into the first round
+                long long slice = timeQuantum + (m > 1 ? switchCost : 0);
+                for (int i = 0; i < m; i++) {
+                    int p = rr_at(&ready, i);
+                    remaining[p] -= (int)(k * timeQuantum);
+                    if (pt->start[p] < 0)
+                        pt->start[p] = currentTime + fixed + i * slice + (m > 1 ? switchCost : 0);
                 }
+                if (timeline != NULL && m == 1) {
+                    timeline_add(timeline, currentTime + fixed, k * timeQuantum, pt->id[rr_at(&ready, 0)]);
+                } else if (timeline != NULL) {
+                    for (long long r = 0; r < k; r++)
+                        for (int i = 0; i < m; i++)
+                            timeline_add(timeline, currentTime + fixed + r * round + i * slice + switchCost,
+                                         timeQuantum, pt->id[rr_at(&ready, i)]);
+                }
+                long long switches = m > 1 ? k * m - freeDispatch : firstSwitch;
+                if (showOrder)
+                    printf("Time %lld-%lld: %lld rounds of %d processes\n", currentTime,
+                           currentTime + k * round + fixed, k, m);
+                currentTime += k * round + fixed;
+                st->fastForwards++;
+                st->slicesSkipped += k * m;
+                st->switches += switches;
+                st->switchTime += switches * switchCost;
+                lastRun = rr_at(&ready, m - 1);
             }
         }
-        
-        // If no process was executed in this cycle (all completed or idle)
-        if(allIdle) {
-            currentTime++;
+        untilCheck--;
+
+        // Execute process for quantum or remaining time
+        int i = rr_pop(&ready);
+        if (lastRun >= 0 && i != lastRun) {
+            currentTime += switchCost;
+            st->switches++;
+            st->switchTime += switchCost;
+        }
+        lastRun = i;
+        if (pt->start[i] < 0) pt->start[i] = currentTime;
+        int executionTime = (remaining[i] < timeQuantum) ? remaining[i] : timeQuantum;
+        if (showOrder)
+            printf("Time %lld-%lld: P%d\n", currentTime, currentTime + executionTime, pt->id[i]);
+        if (timeline != NULL) timeline_add(timeline, currentTime, executionTime, pt->id[i]);
+        currentTime += executionTime;
+        remaining[i] -= executionTime;
+        st->slices++;
+
+        while (next < n && arrival[next] <= currentTime) rr_push(&ready, next++);
+
+        // If process completed
+        if (remaining[i] == 0) {
+            pt_finish(pt, i, currentTime);
+            completed++;
+        } else {
+            rr_push(&ready, i);
         }
     }
-    
-    // Display results
-    printf("\nRound Robin Scheduling Results (Quantum=%d):\n", timeQuantum);
-    printf("PID\tBurst\tWait\tTurnaround\n");
-    
-    for(i = 0; i < n; i++) {
-        printf("P%d\t%d\t%d\t%d\n", 
-               p[i].id, p[i].burstTime, p[i].waitingTime, p[i].turnaroundTime);
-    }
-    
-    avgWait = (float)totalWait / n;
-    avgTurnaround = (float)totalTurnaround / n;
-    
-    printf("\nAverage waiting time: %.2f\n", avgWait);
-    printf("Average turnaround time: %.2f\n", avgTurnaround);
-    
+    rr_queue_free(&ready);
+}
+
+// Parse a list like "1,2,4" or "1-64:4" (from-to:step; the step defaults
+// to 1) of values >= minValue. Returns how many, or 0 if it is malformed.
+static int parseList(const char *list, int minValue, int **out) {
+    int count = 0, capacity = 16;
+    int *values = malloc(capacity * sizeof(int));
+    while (values != NULL && *list) {
+        char *end;
+        long from = strtol(list, &end, 10), to, step = 1;
+        if (end == list) break;
+        to = from;
+        if (*end == '-') {
+            list = end + 1;
+            to = strtol(list, &end, 10);
+            if (end == list) break;
+            if (*end == ':') {
+                list = end + 1;
+                step = strtol(list, &end, 10);
+                if (end == list) break;
+            }
+        }
+        if (from < minValue || to < from || step <= 0 || to > 1000000000L) break;
+        for (long v = from; v <= to; v += step) {
+            if (count == capacity) {
+                capacity *= 2;
+                int *grown = realloc(values, capacity * sizeof(int));
+                if (grown == NULL) free(values);
+                values = grown;
+                if (values == NULL) break;
+            }
+            if (values != NULL) values[count++] = (int)v;
+        }
+        if (values == NULL || (*end != ',' && *end != '\0')) break;
+        list = (*end == ',') ? end + 1 : end;
+        if (*list == '\0') {
+            *out = values;
+            return count;
+        }
+    }
+    free(values);
+    return 0;
+}
+
+// One configuration of a sweep, and its results
+struct SweepConfig {
+    int timeQuantum;
+    int switchCost;
+    pt_summary wait, turnaround;
+    long long waitP99, turnaroundP99;
+    struct RoundRobinStats st;
+    double seconds;             // CPU time of its worker thread
+};
+
+// The workload is loaded and sorted once, then shared read-only by all
+// workers. Each worker has its own pt_fork of it for the per-run columns,
+// and claims configurations one at a time from an atomic counter until
+// none are left, so a slow configuration never holds up the others.
+struct Sweep {
+    const process_table *pt;
+    struct SweepConfig *configs;
+    int count;
+    atomic_int next;
+};
+
+static double secondsSince(clockid_t clock, const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void *sweepWorker(void *arg) {
+    struct Sweep *sweep = arg;
+    process_table run;
+    pt_latency latency;
+    pt_fork(&run, sweep->pt);
+    pt_attach_latency(&run, &latency);
+
+    for (int c; (c = atomic_fetch_add(&sweep->next, 1)) < sweep->count; ) {
+        struct SweepConfig *cfg = &sweep->configs[c];
+        struct timespec start;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+        runRoundRobin(&run, cfg->timeQuantum, cfg->switchCost, 0, 1, NULL, &cfg->st);
+        cfg->wait = pt_summarize(run.wait, run.count);
+        cfg->turnaround = pt_summarize(run.turnaround, run.count);
+        cfg->waitP99 = latency_hist_percentile(&latency.wait, 0.99);
+        cfg->turnaroundP99 = latency_hist_percentile(&latency.turnaround, 0.99);
+        cfg->seconds = secondsSince(CLOCK_THREAD_CPUTIME_ID, &start);
+    }
+    pt_fork_free(&run);
+    return NULL;
+}
+
+// ./Round_robin TRACE_FILE --sweep QUANTA [--switch COSTS] [--threads N]
+static int sweepMain(int argc, char *argv[]) {
+    int *quanta = NULL, *costs = NULL;
+    int nQuanta = 0, nCosts = 0, threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int ok = 1;
+
+    for (int i = 2; i < argc && ok; i++) {
+        if (strcmp(argv[i], "--sweep") == 0 && i + 1 < argc) ok = (nQuanta = parseList(argv[++i], 1, &quanta)) > 0;
+        else if (strcmp(argv[i], "--switch") == 0 && i + 1 < argc) ok = (nCosts = parseList(argv[++i], 0, &costs)) > 0;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) ok = (threads = (int)strtol(argv[++i], NULL, 10)) > 0;
+        else ok = 0;
+    }
+    if (!ok || nQuanta == 0) {
+        printf("Usage: %s TRACE_FILE --sweep QUANTA [--switch COSTS] [--threads N]\n", argv[0]);
+        printf("QUANTA (>= 1) and COSTS (>= 0) are lists like \"1,2,4\" or \"1-64:4\"\n");
+        return EXIT_FAILURE;
+    }
+    if (nCosts == 0) {
+        costs = calloc(1, sizeof(int));
+        nCosts = 1;
+    }
+
+    process_table pt;
+    pt_init(&pt, 1024);
+    pt_load(&pt, argv[1], 1);
+    if (pt.count == 0) {
+        printf("No processes in '%s'\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    pt_sort_by(&pt, pt.arrival);
+
+    struct Sweep sweep;
+    sweep.pt = &pt;
+    sweep.count = nQuanta * nCosts;
+    sweep.configs = calloc(sweep.count, sizeof(struct SweepConfig));
+    atomic_init(&sweep.next, 0);
+    for (int q = 0; q < nQuanta; q++)
+        for (int c = 0; c < nCosts; c++) {
+            sweep.configs[q * nCosts + c].timeQuantum = quanta[q];
+            sweep.configs[q * nCosts + c].switchCost = costs[c];
+        }
+    if (threads > sweep.count) threads = sweep.count;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+    for (int t = 0; t < threads; t++) {
+        if (pthread_create(&workers[t], NULL, sweepWorker, &sweep) != 0) {
+            printf("Failed to create sweep worker %d\n", t);
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int t = 0; t < threads; t++) pthread_join(workers[t], NULL);
+    double wall = secondsSince(CLOCK_MONOTONIC, &start);
+
+    printf("Round Robin sweep over %s: %d processes, %d configurations\n",
+           argv[1], pt.count, sweep.count);
+    printf("\nQuantum\tSwitch\tAvg wait\tp99 wait\tAvg turnaround\tp99 turnaround\tSwitches\n");
+    double busy = 0;
+    for (int c = 0; c < sweep.count; c++) {
+        const struct SweepConfig *cfg = &sweep.configs[c];
+        printf("%d\t%d\t%.2f\t\t%lld\t\t%.2f\t\t%lld\t\t%lld\n", cfg->timeQuantum,
+               cfg->switchCost, cfg->wait.mean, cfg->waitP99, cfg->turnaround.mean,
+               cfg->turnaroundP99, cfg->st.switches);
+        busy += cfg->seconds;
+    }
+    // CPU time over wall time: how many cores were kept busy simulating
+    printf("\n%d threads: %.3f s wall, %.3f s CPU in simulation (%.2fx)\n",
+           threads, wall, busy, busy / wall);
+
+    free(workers);
+    free(sweep.configs);
+    free(quanta);
+    free(costs);
+    pt_free(&pt);
     return 0;
 }
+
+// --verify: rerun pt, already simulated with st, one slice at a time on a
+// fork and report the first difference from the fast-forwarded run.
+// Returns 1 when both runs agree on every process and every counter.
+static int verifyFastForward(const process_table *pt, int timeQuantum, int switchCost,
+                             const struct RoundRobinStats *st) {
+    process_table ref;
+    struct RoundRobinStats refSt;
+    int ok = 1;
+    pt_fork(&ref, pt);
+    runRoundRobin(&ref, timeQuantum, switchCost, 0, 0, NULL, &refSt);
+    for (int i = 0; i < pt->count && ok; i++) {
+        if (pt->start[i] != ref.start[i] || pt->turnaround[i] != ref.turnaround[i]) {
+            printf("Verify: P%d differs: start %lld vs %lld, turnaround %lld vs %lld one slice at a time\n",
+                   pt->id[i], pt->start[i], ref.start[i], pt->turnaround[i], ref.turnaround[i]);
+            ok = 0;
+        }
+    }
+    if (ok && (st->switches != refSt.switches || st->switchTime != refSt.switchTime ||
+               st->idleTime != refSt.idleTime || st->slices + st->slicesSkipped != refSt.slices)) {
+        printf("Verify: %lld slices, switches %lld (%lld ticks), idle %lld vs %ld slices, switches %lld (%lld ticks), idle %lld one slice at a time\n",
+               st->slices + st->slicesSkipped, st->switches, st->switchTime, st->idleTime,
+               refSt.slices, refSt.switches, refSt.switchTime, refSt.idleTime);
+        ok = 0;
+    }
+    if (ok)
+        printf("Verify: fast-forwarded run matches %ld slices run one at a time\n", refSt.slices);
+    pt_fork_free(&ref);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    int n, i, timeQuantum, switchCost = 0;
+    int showOrder = 1, summary = 0, verify = 0;
+    const char *timelinePath = NULL;
+    int timelineCsv = 0;
+    process_table pt;
+    pt_latency latency;
+
+    if (argc >= 3 && strcmp(argv[2], "--sweep") == 0) return sweepMain(argc, argv);
+    if (argc >= 3) {
+        pt_init(&pt, 1024);
+        pt_attach_latency(&pt, &latency);
+        pt_load(&pt, argv[1], 1);
+        n = pt.count;
+        timeQuantum = (int)strtol(argv[2], NULL, 10);
+        showOrder = 0;
+        for (i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "--order") == 0) showOrder = 1;
+            else if (strcmp(argv[i], "--summary") == 0) summary = 1;
+            else if (strcmp(argv[i], "--verify") == 0) verify = 1;
+            else if (strcmp(argv[i], "--switch") == 0 && i + 1 < argc) switchCost = (int)strtol(argv[++i], NULL, 10);
+            else if ((strcmp(argv[i], "--timeline") == 0 || strcmp(argv[i], "--timeline-csv") == 0) && i + 1 < argc) {
+                timelineCsv = strcmp(argv[i], "--timeline-csv") == 0;
+                timelinePath = argv[++i];
+            }
+            else timeQuantum = 0;
+        }
+        if (n == 0 || timeQuantum <= 0 || switchCost < 0) {
+            printf("Usage: %s [TRACE_FILE QUANTUM [--switch COST] [--order] [--summary]\n", argv[0]);
+            printf("                   [--timeline FILE | --timeline-csv FILE] [--verify]]\n");
+            printf("       %s TRACE_FILE --sweep QUANTA [--switch COSTS] [--threads N]\n", argv[0]);
+            printf("The trace must hold at least one process, the quantum must be positive\n");
+            printf("and the switch cost must not be negative\n");
+            return EXIT_FAILURE;
+        }
+    } else if (argc == 1) {
+        printf("Enter the number of processes: ");
+        if (scanf("%d", &n) != 1 || n <= 0) {
+            printf("\nThe number of processes must be positive\n");
+            return EXIT_FAILURE;
+        }
+
+        printf("Enter time quantum: ");
+        if (scanf("%d", &timeQuantum) != 1 || timeQuantum <= 0) {
+            printf("\nThe time quantum must be positive\n");
+            return EXIT_FAILURE;
+        }
+
+        pt_init(&pt, n);
+        pt_attach_latency(&pt, &latency);
+        printf("\nEnter process details:\n");
+        for(i = 0; i < n; i++) {
+            int arrival, burst;
+            printf("P%d arrival time: ", i + 1);
+            scanf("%d", &arrival);
+            printf("P%d burst time: ", i + 1);
+            scanf("%d", &burst);
+            pt_add(&pt, arrival, burst, 0);
+            if (burst <= 0) {
+                printf("\nBurst times must be positive\n");
+                return EXIT_FAILURE;
+            }
+        }
+    } else {
+        printf("Usage: %s [TRACE_FILE QUANTUM [--switch COST] [--order] [--summary]\n", argv[0]);
+        printf("                   [--timeline FILE | --timeline-csv FILE] [--verify]]\n");
+        printf("       %s TRACE_FILE --sweep QUANTA [--switch COSTS] [--threads N]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Round Robin Simulation
+    struct RoundRobinStats st;
+    timeline_writer timeline;
+    long long timelineRecords = 0;
+    if (timelinePath != NULL) timeline_open(&timeline, timelinePath, timelineCsv);
+    if (showOrder) printf("\nRound Robin Execution Order:\n");
+    pt_sort_by(&pt, pt.arrival);
+    runRoundRobin(&pt, timeQuantum, switchCost, showOrder, 1, timelinePath != NULL ? &timeline : NULL, &st);
+    if (timelinePath != NULL) timelineRecords = (long long)timeline_close(&timeline);
+
+    // Display results: waiting is the time in the system not spent running
+    printf("\nRound Robin Scheduling Results (Quantum=%d):\n", timeQuantum);
+    if (!summary) {
+        printf("PID\tArrival\tBurst\tWait\tTurnaround\n");
+        for(i = 0; i < n; i++)
+            printf("P%d\t%d\t%d\t%lld\t%lld\n",
+                   pt.id[i], pt.arrival[i], pt.burst[i], pt.wait[i], pt.turnaround[i]);
+    }
+
+    pt_summary wait = pt_summarize(pt.wait, n);
+    pt_summary turnaround = pt_summarize(pt.turnaround, n);
+    printf("\nAverage waiting time: %.2f\n", (float)wait.sum / n);
+    printf("Average turnaround time: %.2f\n", (float)turnaround.sum / n);
+    pt_print_summary("Waiting time", &wait);
+    pt_print_summary("Turnaround time", &turnaround);
+    printf("Slices: %ld one at a time, %lld in %ld fast-forwards, idle time: %lld\n",
+           st.slices, st.slicesSkipped, st.fastForwards, st.idleTime);
+    if (switchCost > 0)
+        printf("Context switches: %lld, costing %lld ticks\n", st.switches, st.switchTime);
+    if (timelinePath != NULL)
+        printf("Timeline: %lld records written to %s\n", timelineRecords, timelinePath);
+    printf("\n");
+    pt_print_latency(&latency);
+
+    int verified = !verify || verifyFastForward(&pt, timeQuantum, switchCost, &st);
+    pt_free(&pt);
+    return verified ? 0 : EXIT_FAILURE;
+}
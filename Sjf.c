@@ -1,69 +1,245 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "process_table.h"
 
-struct Process {
-    int id;
-    int burstTime;
-    int waitingTime;
-    int turnaroundTime;
+// Usage: ./Sjf                               non-preemptive SJF, all processes arrive at 0
+//        ./Sjf --srtf [TRACE_FILE] [--summary]
+//                                            shortest remaining time first with arrival
+//                                            times, entered by hand or read from a file of
+//                                            "arrival burst" lines; --summary skips the table
+
+// Binary min-heap of ready processes. Each item packs the remaining time
+// above the process's index in the arrival-sorted array, so items order by
+// remaining time, then arrival, then input order, without touching the
+// process table.
+struct ReadyHeap {
+    uint64_t *items;
+    int size;
 };
 
-int main() {
-    int n, i, j;
-    struct Process temp;
-    float avgWait = 0, avgTurnaround = 0;
-    
+static uint64_t heapKey(const process_table *pt, int idx) {
+    return ((uint64_t)pt->remaining[idx] << 32) | (uint32_t)idx;
+}
+
+static void heapPush(struct ReadyHeap *h, uint64_t key) {
+    int i = h->size++;
+    while (i > 0 && key < h->items[(i - 1) / 2]) {
+        h->items[i] = h->items[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    h->items[i] = key;
+}
+
+static int heapPop(struct ReadyHeap *h) {
+    uint64_t top = h->items[0];
+    uint64_t last = h->items[--h->size];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= h->size) break;
+        if (child + 1 < h->size && h->items[child + 1] < h->items[child]) child++;
+        if (h->items[child] >= last) break;
+        h->items[i] = h->items[child];
+        i = child;
+    }
+    if (h->size > 0) h->items[i] = last;
+    return (int)(uint32_t)top;
+}
+
+// Shortest remaining time first. Time only moves between events: the next
+// arrival or the running process's completion. At an arrival the running
+// process is charged for the time since the last event, and is preempted
+// if a ready process now has strictly less time left. Every event costs
+// O(log n), so the run is O(n log n) however long the bursts are.
+// Returns the number of preemptions; the table ends up sorted by arrival.
+static long runSrtf(process_table *pt) {
+    int n = pt->count;
+    struct ReadyHeap ready = { malloc(n * sizeof(uint64_t)), 0 };
+    long preemptions = 0;
+    long long now = 0;
+    int next = 0;           // next process to arrive
+    int running = -1;
+
+    if (ready.items == NULL) {
+        printf("Out of memory for %d processes\n", n);
+        exit(EXIT_FAILURE);
+    }
+    pt_sort_by(pt, pt->arrival);
+
+    while (next < n || running >= 0 || ready.size > 0) {
+        if (running < 0) {
+            // Idle: jump to the next arrival
+            if (ready.size == 0 && now < pt->arrival[next]) now = pt->arrival[next];
+            while (next < n && pt->arrival[next] <= now) { heapPush(&ready, heapKey(pt, next)); next++; }
+            running = heapPop(&ready);
+            if (pt->start[running] < 0) pt->start[running] = now;
+        }
+
+        long long finish = now + pt->remaining[running];
+        if (next < n && pt->arrival[next] < finish) {
+            // Arrival event: charge the running process, then enqueue
+            // everyone arriving at this time
+            long long t = pt->arrival[next];
+            if (t > now) {
+                pt->remaining[running] -= (int)(t - now);
+                now = t;
+            }
+            while (next < n && pt->arrival[next] <= now) { heapPush(&ready, heapKey(pt, next)); next++; }
+            if ((ready.items[0] >> 32) < (uint64_t)pt->remaining[running]) {
+                heapPush(&ready, heapKey(pt, running));
+                running = -1;
+                preemptions++;
+            }
+        } else {
+            // Completion event
+            now = finish;
+            pt->remaining[running] = 0;
+            pt_finish(pt, running, now);
+            running = -1;
+        }
+    }
+    free(ready.items);
+    return preemptions;
+}
+
+// Averages, then sum/min/max/variance; response is NULL for plain SJF
+static void printStats(const process_table *pt, const long long *response) {
+    pt_summary wait = pt_summarize(pt->wait, pt->count);
+    pt_summary turnaround = pt_summarize(pt->turnaround, pt->count);
+    pt_summary resp = pt_summarize(response, response != NULL ? pt->count : 0);
+
+    printf("Average waiting time: %.2f\n", (float)wait.sum / pt->count);
+    if (response != NULL) printf("Average response time: %.2f\n", (float)resp.sum / pt->count);
+    printf("Average turnaround time: %.2f\n", (float)turnaround.sum / pt->count);
+    pt_print_summary("Waiting time", &wait);
+    if (response != NULL) pt_print_summary("Response time", &resp);
+    pt_print_summary("Turnaround time", &turnaround);
+    printf("\n");
+    pt_print_latency(pt->latency);
+}
+
+static int srtfMain(int argc, char *argv[]) {
+    const char *path = NULL;
+    int summary = 0;
+    int n = 0;
+    process_table pt;
+    pt_latency latency;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--summary") == 0) summary = 1;
+        else if (path == NULL) path = argv[i];
+        else {
+            printf("Usage: %s --srtf [TRACE_FILE] [--summary]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (path != NULL) {
+        pt_init(&pt, 1024);
+        pt_attach_latency(&pt, &latency);
+        pt_load(&pt, path, 0);
+        n = pt.count;
+    } else {
+        printf("Enter the number of processes: ");
+        if (scanf("%d", &n) != 1 || n <= 0) {
+            printf("\nThe number of processes must be positive\n");
+            return EXIT_FAILURE;
+        }
+        pt_init(&pt, n);
+        pt_attach_latency(&pt, &latency);
+        printf("\nEnter process details:\n");
+        for (int i = 0; i < n; i++) {
+            int arrival, burst;
+            printf("P%d arrival time: ", i + 1);
+            scanf("%d", &arrival);
+            printf("P%d burst time: ", i + 1);
+            scanf("%d", &burst);
+            pt_add(&pt, arrival, burst, 0);
+        }
+    }
+    if (n == 0) {
+        printf("No processes in '%s'\n", path);
+        pt_free(&pt);
+        return EXIT_FAILURE;
+    }
+
+    long preemptions = runSrtf(&pt);
+
+    // Waiting = turnaround - burst; response = first run - arrival
+    long long *response = malloc(n * sizeof(long long));
+    if (response == NULL) {
+        printf("Out of memory for %d processes\n", n);
+        pt_free(&pt);
+        return EXIT_FAILURE;
+    }
+    pt_response_times(&pt, response);
+
+    printf("\nSRTF Scheduling Results:\n");
+    if (!summary) {
+        printf("PID\tArrival\tBurst\tWait\tResponse\tTurnaround\tCompletion\n");
+        for (int i = 0; i < n; i++)
+            printf("P%d\t%d\t%d\t%lld\t%lld\t\t%lld\t\t%lld\n", pt.id[i], pt.arrival[i],
+                   pt.burst[i], pt.wait[i], response[i], pt.turnaround[i],
+                   pt.arrival[i] + pt.turnaround[i]);
+    }
+
+    printf("\nProcesses: %d, preemptions: %ld\n", n, preemptions);
+    printStats(&pt, response);
+    free(response);
+    pt_free(&pt);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int n, i, burst;
+    process_table pt;
+    pt_latency latency;
+
+    if (argc > 1 && strcmp(argv[1], "--srtf") == 0) return srtfMain(argc, argv);
+    if (argc > 1) {
+        printf("Usage: %s [--srtf [TRACE_FILE] [--summary]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
     printf("Enter the number of processes: ");
-    scanf("%d", &n);
-    
-    struct Process p[n];
-    
+    if (scanf("%d", &n) != 1 || n <= 0) {
+        printf("\nThe number of processes must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    pt_init(&pt, n);
+    pt_attach_latency(&pt, &latency);
     printf("\nEnter process details:\n");
     for(i = 0; i < n; i++) {
-        p[i].id = i + 1;
         printf("P%d burst time: ", i + 1);
-        scanf("%d", &p[i].burstTime);
+        scanf("%d", &burst);
+        pt_add(&pt, 0, burst, 0);
     }
-    
+
     // Sort by burst time (ascending) - SJF
-    for(i = 0; i < n - 1; i++) {
-        for(j = 0; j < n - i - 1; j++) {
-            if(p[j].burstTime > p[j+1].burstTime) {
-                temp = p[j];
-                p[j] = p[j+1];
-                p[j+1] = temp;
-            }
-        }
-    }
-    
-    // Calculate waiting and turnaround times
-    p[0].waitingTime = 0;
-    p[0].turnaroundTime = p[0].burstTime;
-    
-    for(i = 1; i < n; i++) {
-        p[i].waitingTime = p[i-1].turnaroundTime;
-        p[i].turnaroundTime = p[i].waitingTime + p[i].burstTime;
+    pt_sort_by(&pt, pt.burst);
+
+    // Calculate waiting and turnaround times: everyone arrives at 0, so each
+    // process completes when the one before it has, plus its own burst
+    long long completion = 0;
+    for(i = 0; i < n; i++) {
+        completion += pt.burst[i];
+        pt_finish(&pt, i, completion);
     }
-    
+
     // Display results
-    int totalWait = 0;
-    int totalTurnaround = 0;
-    
     printf("\nSJF Scheduling Results:\n");
     printf("PID\tBurst\tWait\tTurnaround\n");
-    
+
     for(i = 0; i < n; i++) {
-        totalWait += p[i].waitingTime;
-        totalTurnaround += p[i].turnaroundTime;
-        
-        printf("P%d\t%d\t%d\t%d\n", 
-               p[i].id, p[i].burstTime, p[i].waitingTime, p[i].turnaroundTime);
+        printf("P%d\t%d\t%lld\t%lld\n",
+               pt.id[i], pt.burst[i], pt.wait[i], pt.turnaround[i]);
     }
-    
-    avgWait = (float)totalWait / n;
-    avgTurnaround = (float)totalTurnaround / n;
-    
-    printf("\nAverage waiting time: %.2f\n", avgWait);
-    printf("Average turnaround time: %.2f\n", avgTurnaround);
-    
+
+    printf("\n");
+    printStats(&pt, NULL);
+    pt_free(&pt);
     return 0;
 }
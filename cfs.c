@@ -1,5 +1,20 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "cfs_trace.h"
+#include "latency_hist.h"
+#include "timeline.h"
 
 // ==========================================
 // PART 1: DATA STRUCTURES
@@ -7,41 +22,250 @@
 
 #define PROCESS_COUNT 5
 #define NICE_0_LOAD 1024
+#define NICE_0_SHIFT 10          // log2(NICE_0_LOAD)
+#define WMULT_SHIFT 32
+#define TICK_NS 1000000ULL       // one tick of CPU time, in nanoseconds
+#define SLEEPER_CREDIT_NS (3 * TICK_NS)   // half the kernel's default 6 ms latency
 
-typedef struct {
-    int id;
-    int vruntime;
-    int residual_duration;
-} process;
+// Kernel defaults for the timeslice model (sysctl_sched_*)
+#define SCHED_LATENCY_NS            6000000ULL   // target period to run every task once
+#define SCHED_MIN_GRANULARITY_NS     750000ULL   // shortest slice when the period stretches
+#define SCHED_WAKEUP_GRANULARITY_NS 1000000ULL   // vruntime lead a wakee needs to preempt
 
-typedef struct {
-    int key;
-    void *object;
-} mydata;
+#define RB_RED   0
+#define RB_BLACK 1
 
 typedef struct rbnode {
-    mydata *data;
     struct rbnode *left;
     struct rbnode *right;
+    struct rbnode *parent;
+    int color;
 } rbnode;
 
+// leftmost caches the smallest node so picking the next task is O(1)
 typedef struct {
     rbnode *root;
-    int (*compare)(const void *, const void *);
+    rbnode *leftmost;
+    int (*compare)(const rbnode *, const rbnode *);
 } rbtree;
 
 rbnode* rb_find_min(rbnode *node);
-#define RB_MINIMAL(tree) rb_find_min(tree->root)
+#define RB_MINIMAL(tree) ((tree)->leftmost)
+
+// Recover the structure that embeds a node
+#define rb_entry(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+
+// Intrusive run-queue node. Every engine orders nodes by (key, seq): key is
+// the vruntime at enqueue time and seq the enqueue order, so ties run FIFO
+// whichever engine is in use. Each engine links through its own union member.
+typedef struct rq_node {
+    uint64_t key;
+    uint64_t seq;
+    union {
+        rbnode rb;
+        struct { struct rq_node *child, *sibling, *prev; } ph;
+        struct { struct rq_node *next, *prev; int bucket; } rx;
+        int heap_index;
+    };
+} rq_node;
+
+#define DARY_ARITY    4
+#define RADIX_BUCKETS 65
+#define RADIX_UNDERFLOW RADIX_BUCKETS   // list index for keys below `last`
+
+struct rq_ops;
+
+typedef struct {
+    const struct rq_ops *ops;
+    uint64_t next_seq;
+    union {
+        rbtree rb;
+        struct { rq_node *root; } ph;
+        struct { rq_node **heap; int size, capacity; } dary;
+        struct {
+            rq_node *head[RADIX_BUCKETS + 1];
+            rq_node *tail[RADIX_BUCKETS + 1];
+            uint64_t last;        // last extracted minimum
+            uint64_t nonempty;    // bit b-1 set when bucket b (1..64) has nodes
+        } radix;
+    };
+} run_queue;
+
+// The run-queue interface the scheduler is written against
+typedef struct rq_ops {
+    const char *name;
+    void (*init)(run_queue *rq);
+    void (*destroy)(run_queue *rq);
+    void (*insert)(run_queue *rq, rq_node *node);
+    rq_node* (*peek_min)(run_queue *rq);
+    rq_node* (*pop_min)(run_queue *rq);
+    void (*remove)(run_queue *rq, rq_node *node);
+    void (*update_key)(run_queue *rq, rq_node *node, uint64_t key);
+    int (*validate)(run_queue *rq);   // node count, or -1 on a broken invariant
+} rq_ops;
+
+int compare_func(const rbnode *left, const rbnode *right);
+
+typedef struct list_node {
+    struct list_node *next;
+    struct list_node *prev;
+} list_node;
+
+// weight and its precomputed 2^32 / weight, so the hot path never divides
+typedef struct {
+    unsigned long weight;
+    uint32_t inv_weight;
+} load_weight;
+
+struct cfs_rq;
+
+// Per-task scheduling state. The run-queue node lives inside the entity,
+// like the kernel's sched_entity, so requeueing a task re-links it without
+// allocating. A task is on at most one queue at a time, so a sleeping task
+// reuses run_node on the simulator's sleep queue.
+//
+// An entity is either a task or a group (my_q != NULL). A group is queued
+// on its parent's queue like any task and owns a queue of its own.
+typedef struct sched_entity {
+    rq_node run_node;
+    list_node group_node;        // position on the run queue's cfs_tasks list
+    load_weight load;
+    uint64_t vruntime;           // virtual nanoseconds; 64-bit so it never wraps
+    uint64_t sum_exec_runtime;   // real nanoseconds on the CPU; 0 until first run
+    uint64_t prev_sum_exec_runtime;   // sum_exec_runtime when last picked
+    struct sched_entity *parent; // enclosing group's entity; NULL at the top level
+    struct cfs_rq *cfs_rq;       // queue this entity is queued on
+    struct cfs_rq *my_q;         // a group's own queue; NULL for a task
+    int depth;                   // 0 at the top level
+    int on_rq;
+} sched_entity;
+
+typedef struct {
+    int id;
+    int nice;
+    sched_entity se;
+    int residual_duration;
+    long finish_tick;
+    long arrival_tick;           // first becomes runnable at this tick
+    int cpu_burst;               // ticks of CPU between blocks; 0 never blocks
+    int io_ticks;                // ticks asleep after each burst
+    int burst_left;
+    long runnable_since;         // tick it last arrived or woke, -1 once picked
+} process;
+
+// Processes are carved out of fixed-size chunks and released in one step
+#define POOL_CHUNK_PROCESSES 1024
+
+typedef struct pool_chunk {
+    struct pool_chunk *next;
+    int used;
+    process items[POOL_CHUNK_PROCESSES];
+} pool_chunk;
+
+typedef struct {
+    pool_chunk *chunks;
+} process_pool;
+
+// One CFS run queue. The running entity (curr) is kept out of the tree
+// while it runs, as in the kernel. In the hierarchical loop it still counts
+// in nr_running and load_weight; the flat --smp loop dequeues it fully.
+typedef struct cfs_rq {
+    run_queue tasks_timeline;
+    list_node cfs_tasks;         // queued tasks in enqueue order, for load balancing
+    int nr_running;
+    long load_weight;
+    uint64_t min_vruntime;
+    sched_entity *curr;
+} cfs_rq;
+
+// A group of tasks and child groups sharing one weight, like a cgroup with
+// cpu.shares. The simulation has one CPU, so one entity and one queue.
+typedef struct task_group {
+    sched_entity se;             // the group as queued on its parent's queue
+    cfs_rq my_q;                 // the group's own queue
+    int id;
+} task_group;
+
+// Nice levels -20..19 map to weights that differ by ~1.25x per level, so a
+// task gets ~10% more CPU than a task one nice level above it (same table as
+// the kernel's sched_prio_to_weight)
+static const int sched_prio_to_weight[40] = {
+ /* -20 */     88761,     71755,     56483,     46273,     36291,
+ /* -15 */     29154,     23254,     18705,     14949,     11916,
+ /* -10 */      9548,      7620,      6100,      4904,      3906,
+ /*  -5 */      3121,      2501,      1991,      1586,      1277,
+ /*   0 */      1024,       820,       655,       526,       423,
+ /*   5 */       335,       272,       215,       172,       137,
+ /*  10 */       110,        87,        70,        56,        45,
+ /*  15 */        36,        29,        23,        18,        15,
+};
+
+// 2^32 / sched_prio_to_weight[i], precomputed
+static const uint32_t sched_prio_to_wmult[40] = {
+ /* -20 */     48388,     59856,     76040,     92818,    118348,
+ /* -15 */    147320,    184698,    229616,    287308,    360437,
+ /* -10 */    449829,    563644,    704093,    875809,   1099582,
+ /*  -5 */   1376151,   1717300,   2157191,   2708050,   3363326,
+ /*   0 */   4194304,   5237765,   6557202,   8165337,  10153587,
+ /*   5 */  12820798,  15790321,  19976592,  24970740,  31350126,
+ /*  10 */  39045157,  49367440,  61356676,  76695844,  95443717,
+ /*  15 */ 119304647, 148102320, 186737708, 238609294, 286331153,
+};
 
 // ==========================================
 // PART 2: HELPER IMPLEMENTATIONS
 // ==========================================
 
-process* create_process(int id, int vruntime, int residual_duration) {
-    process* p = (process*)malloc(sizeof(process));
+process* pool_alloc(process_pool *pool) {
+    pool_chunk *chunk = pool->chunks;
+    if (chunk == NULL || chunk->used == POOL_CHUNK_PROCESSES) {
+        chunk = (pool_chunk*)malloc(sizeof(pool_chunk));
+        if (chunk == NULL) {
+            printf("Error: out of memory allocating processes\n");
+            exit(EXIT_FAILURE);
+        }
+        chunk->next = pool->chunks;
+        chunk->used = 0;
+        pool->chunks = chunk;
+    }
+    return &chunk->items[chunk->used++];
+}
+
+void pool_destroy(process_pool *pool) {
+    pool_chunk *chunk = pool->chunks;
+    while (chunk != NULL) {
+        pool_chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    pool->chunks = NULL;
+}
+
+void set_load_weight(process *p, int nice) {
+    p->nice = nice;
+    p->se.load.weight = sched_prio_to_weight[nice + 20];
+    p->se.load.inv_weight = sched_prio_to_wmult[nice + 20];
+}
+
+process* create_process(process_pool *pool, int id, int nice, uint64_t vruntime, int residual_duration) {
+    process* p = pool_alloc(pool);
     p->id = id;
-    p->vruntime = vruntime;
+    set_load_weight(p, nice);
+    p->se.vruntime = vruntime;
+    p->se.sum_exec_runtime = 0;
+    p->se.prev_sum_exec_runtime = 0;
+    p->se.parent = NULL;
+    p->se.cfs_rq = NULL;
+    p->se.my_q = NULL;
+    p->se.depth = 0;
+    p->se.on_rq = 0;
     p->residual_duration = residual_duration;
+    p->finish_tick = -1;
+    p->arrival_tick = 0;
+    p->cpu_burst = 0;
+    p->io_ticks = 0;
+    p->burst_left = 0;
+    p->runnable_since = -1;
     return p;
 }
 
@@ -49,21 +273,23 @@ void run_process_for_one_tick(process* p) {
     if (p->residual_duration > 0) p->residual_duration--;
 }
 
+void run_process_for_ticks(process* p, long ticks) {
+    p->residual_duration -= (ticks < p->residual_duration) ? ticks : p->residual_duration;
+}
+
 int is_terminated(process* p) {
     return p->residual_duration <= 0;
 }
 
-mydata* makedata_with_object(int key, void *object) {
-    mydata *d = (mydata*)malloc(sizeof(mydata));
-    d->key = key;
-    d->object = object;
-    return d;
+void rb_init(rbtree *tree, int (*compare)(const rbnode *, const rbnode *)) {
+    tree->root = NULL;
+    tree->leftmost = NULL;
+    tree->compare = compare;
 }
 
-rbtree* rb_create(int (*compare)(const void *, const void *)) {
+rbtree* rb_create(int (*compare)(const rbnode *, const rbnode *)) {
     rbtree *t = (rbtree*)malloc(sizeof(rbtree));
-    t->root = NULL;
-    t->compare = compare;
+    rb_init(t, compare);
     return t;
 }
 
@@ -73,134 +299,2249 @@ rbnode* rb_find_min(rbnode *node) {
     return node;
 }
 
-rbnode* rb_insert(rbtree *tree, mydata *data) {
-    rbnode *new_node = (rbnode*)malloc(sizeof(rbnode));
-    new_node->data = data;
+// In-order successor, used to move the cached leftmost pointer on delete
+rbnode* rb_next(rbnode *node) {
+    if (node->right != NULL) return rb_find_min(node->right);
+    while (node->parent != NULL && node == node->parent->right) node = node->parent;
+    return node->parent;
+}
+
+static int is_red(rbnode *node) {
+    return node != NULL && node->color == RB_RED;
+}
+
+static void rb_rotate_left(rbtree *tree, rbnode *x) {
+    rbnode *y = x->right;
+    x->right = y->left;
+    if (y->left != NULL) y->left->parent = x;
+    y->parent = x->parent;
+    if (x->parent == NULL) tree->root = y;
+    else if (x == x->parent->left) x->parent->left = y;
+    else x->parent->right = y;
+    y->left = x;
+    x->parent = y;
+}
+
+static void rb_rotate_right(rbtree *tree, rbnode *x) {
+    rbnode *y = x->left;
+    x->left = y->right;
+    if (y->right != NULL) y->right->parent = x;
+    y->parent = x->parent;
+    if (x->parent == NULL) tree->root = y;
+    else if (x == x->parent->right) x->parent->right = y;
+    else x->parent->left = y;
+    y->right = x;
+    x->parent = y;
+}
+
+// Restore the red-black properties after linking a new red node
+static void rb_insert_fixup(rbtree *tree, rbnode *node) {
+    rbnode *parent, *gparent, *uncle;
+
+    while ((parent = node->parent) != NULL && parent->color == RB_RED) {
+        gparent = parent->parent;
+        if (parent == gparent->left) {
+            uncle = gparent->right;
+            if (is_red(uncle)) {
+                parent->color = RB_BLACK;
+                uncle->color = RB_BLACK;
+                gparent->color = RB_RED;
+                node = gparent;
+                continue;
+            }
+            if (node == parent->right) {
+                rb_rotate_left(tree, parent);
+                node = parent;
+                parent = node->parent;
+            }
+            parent->color = RB_BLACK;
+            gparent->color = RB_RED;
+            rb_rotate_right(tree, gparent);
+        } else {
+            uncle = gparent->left;
+            if (is_red(uncle)) {
+                parent->color = RB_BLACK;
+                uncle->color = RB_BLACK;
+                gparent->color = RB_RED;
+                node = gparent;
+                continue;
+            }
+            if (node == parent->left) {
+                rb_rotate_right(tree, parent);
+                node = parent;
+                parent = node->parent;
+            }
+            parent->color = RB_BLACK;
+            gparent->color = RB_RED;
+            rb_rotate_left(tree, gparent);
+        }
+    }
+    tree->root->color = RB_BLACK;
+}
+
+// Links a caller-owned node; nothing is allocated
+void rb_insert(rbtree *tree, rbnode *new_node) {
     new_node->left = NULL; new_node->right = NULL;
+    new_node->parent = NULL;
+    new_node->color = RB_RED;
+
+    // Equal keys go right, so tasks with the same vruntime run in FIFO order
+    rbnode *parent = NULL;
+    rbnode **link = &tree->root;
+    int leftmost = 1;
+    while (*link != NULL) {
+        parent = *link;
+        if (tree->compare(new_node, parent) < 0) {
+            link = &parent->left;
+        } else {
+            link = &parent->right;
+            leftmost = 0;
+        }
+    }
+    new_node->parent = parent;
+    *link = new_node;
+    if (leftmost) tree->leftmost = new_node;
+
+    rb_insert_fixup(tree, new_node);
+}
+
+// Rebalance after removing a black node; node is the child that took its
+// place (possibly NULL), parent is that child's parent
+static void rb_erase_fixup(rbtree *tree, rbnode *node, rbnode *parent) {
+    rbnode *sibling;
 
-    if (tree->root == NULL) {
-        tree->root = new_node;
-        return new_node;
+    while (node != tree->root && !is_red(node)) {
+        if (node == parent->left) {
+            sibling = parent->right;
+            if (is_red(sibling)) {
+                sibling->color = RB_BLACK;
+                parent->color = RB_RED;
+                rb_rotate_left(tree, parent);
+                sibling = parent->right;
+            }
+            if (!is_red(sibling->left) && !is_red(sibling->right)) {
+                sibling->color = RB_RED;
+                node = parent;
+                parent = node->parent;
+            } else {
+                if (!is_red(sibling->right)) {
+                    sibling->left->color = RB_BLACK;
+                    sibling->color = RB_RED;
+                    rb_rotate_right(tree, sibling);
+                    sibling = parent->right;
+                }
+                sibling->color = parent->color;
+                parent->color = RB_BLACK;
+                sibling->right->color = RB_BLACK;
+                rb_rotate_left(tree, parent);
+                node = tree->root;
+            }
+        } else {
+            sibling = parent->left;
+            if (is_red(sibling)) {
+                sibling->color = RB_BLACK;
+                parent->color = RB_RED;
+                rb_rotate_right(tree, parent);
+                sibling = parent->left;
+            }
+            if (!is_red(sibling->left) && !is_red(sibling->right)) {
+                sibling->color = RB_RED;
+                node = parent;
+                parent = node->parent;
+            } else {
+                if (!is_red(sibling->left)) {
+                    sibling->right->color = RB_BLACK;
+                    sibling->color = RB_RED;
+                    rb_rotate_left(tree, sibling);
+                    sibling = parent->left;
+                }
+                sibling->color = parent->color;
+                parent->color = RB_BLACK;
+                sibling->left->color = RB_BLACK;
+                rb_rotate_right(tree, parent);
+                node = tree->root;
+            }
+        }
     }
+    if (node != NULL) node->color = RB_BLACK;
+}
+
+static void rb_replace_child(rbtree *tree, rbnode *old, rbnode *new_node, rbnode *parent) {
+    if (parent == NULL) tree->root = new_node;
+    else if (parent->left == old) parent->left = new_node;
+    else parent->right = new_node;
+}
+
+// Unlink a node by identity (not by key), so equal keys never remove the wrong
+// task. The node is not freed; it belongs to the entity that embeds it.
+void rb_delete(rbtree *tree, rbnode *node) {
+    rbnode *child, *parent;
+    int color;
+
+    if (tree->leftmost == node) tree->leftmost = rb_next(node);
 
-    rbnode *current = tree->root;
-    while (1) {
-        int cmp = tree->compare(data, current->data);
-        if (cmp < 0) {
-            if (current->left == NULL) { current->left = new_node; break; }
-            current = current->left;
+    if (node->left != NULL && node->right != NULL) {
+        // Two children: splice the in-order successor into node's position
+        rbnode *succ = rb_find_min(node->right);
+        child = succ->right;
+        parent = succ->parent;
+        color = succ->color;
+
+        if (parent == node) {
+            parent = succ;
         } else {
-            if (current->right == NULL) { current->right = new_node; break; }
-            current = current->right;
+            if (child != NULL) child->parent = parent;
+            parent->left = child;
+            succ->right = node->right;
+            node->right->parent = succ;
         }
+        rb_replace_child(tree, node, succ, node->parent);
+        succ->parent = node->parent;
+        succ->color = node->color;
+        succ->left = node->left;
+        node->left->parent = succ;
+    } else {
+        child = (node->left != NULL) ? node->left : node->right;
+        parent = node->parent;
+        color = node->color;
+        if (child != NULL) child->parent = parent;
+        rb_replace_child(tree, node, child, parent);
+    }
+
+    if (color == RB_BLACK) rb_erase_fixup(tree, child, parent);
+}
+
+// Walk the whole tree and check every red-black invariant plus the cached
+// leftmost pointer. Returns the number of nodes, or -1 on the first violation.
+static int rb_validate_subtree(rbtree *tree, rbnode *node, rbnode *parent, int *black_height) {
+    if (node == NULL) {
+        *black_height = 1;
+        return 0;
+    }
+    if (node->parent != parent) {
+        printf("rb_validate: bad parent pointer\n");
+        return -1;
+    }
+    if (is_red(node) && (is_red(node->left) || is_red(node->right))) {
+        printf("rb_validate: red node has a red child\n");
+        return -1;
+    }
+    if (node->left != NULL && tree->compare(node->left, node) > 0) {
+        printf("rb_validate: left child out of order\n");
+        return -1;
+    }
+    if (node->right != NULL && tree->compare(node->right, node) < 0) {
+        printf("rb_validate: right child out of order\n");
+        return -1;
+    }
+
+    int left_height, right_height;
+    int left_count = rb_validate_subtree(tree, node->left, node, &left_height);
+    if (left_count < 0) return -1;
+    int right_count = rb_validate_subtree(tree, node->right, node, &right_height);
+    if (right_count < 0) return -1;
+    if (left_height != right_height) {
+        printf("rb_validate: black height mismatch\n");
+        return -1;
+    }
+    *black_height = left_height + (node->color == RB_BLACK);
+    return left_count + right_count + 1;
+}
+
+int rb_validate(rbtree *tree) {
+    int black_height;
+    if (is_red(tree->root)) {
+        printf("rb_validate: root is red\n");
+        return -1;
+    }
+    if (tree->leftmost != rb_find_min(tree->root)) {
+        printf("rb_validate: cached leftmost is stale\n");
+        return -1;
+    }
+    return rb_validate_subtree(tree, tree->root, NULL, &black_height);
+}
+
+// ------------------------------------------
+// Run-queue engines. Every engine orders nodes by (key, seq) and links
+// them through its own member of rq_node, so none of them allocate per
+// operation (the d-ary heap only grows its array when it fills).
+// ------------------------------------------
+
+static inline int rq_node_before(const rq_node *a, const rq_node *b) {
+    int64_t diff = (int64_t)(a->key - b->key);
+    if (diff != 0) return diff < 0;
+    return a->seq < b->seq;
+}
+
+// --- Red-black tree: the balanced tree above, with its cached leftmost ---
+
+static void rbq_init(run_queue *rq) {
+    rb_init(&rq->rb, compare_func);
+}
+
+static void rbq_destroy(run_queue *rq) {
+    (void)rq;
+}
+
+static void rbq_insert(run_queue *rq, rq_node *node) {
+    rb_insert(&rq->rb, &node->rb);
+}
+
+static rq_node* rbq_peek_min(run_queue *rq) {
+    rbnode *leftmost = RB_MINIMAL(&rq->rb);
+    return leftmost ? rb_entry(leftmost, rq_node, rb) : NULL;
+}
+
+static void rbq_remove(run_queue *rq, rq_node *node) {
+    rb_delete(&rq->rb, &node->rb);
+}
+
+static rq_node* rbq_pop_min(run_queue *rq) {
+    rq_node *node = rbq_peek_min(rq);
+    if (node != NULL) rb_delete(&rq->rb, &node->rb);
+    return node;
+}
+
+static void rbq_update_key(run_queue *rq, rq_node *node, uint64_t key) {
+    rb_delete(&rq->rb, &node->rb);
+    node->key = key;
+    node->seq = rq->next_seq++;
+    rb_insert(&rq->rb, &node->rb);
+}
+
+static int rbq_validate(run_queue *rq) {
+    return rb_validate(&rq->rb);
+}
+
+// --- Pairing heap: child / next-sibling links; prev points at the left
+// sibling, or at the parent for a first child ---
+
+static rq_node* ph_meld(rq_node *a, rq_node *b) {
+    if (rq_node_before(b, a)) {
+        rq_node *t = a; a = b; b = t;
     }
-    return new_node;
+    b->ph.prev = a;
+    b->ph.sibling = a->ph.child;
+    if (a->ph.child != NULL) a->ph.child->ph.prev = b;
+    a->ph.child = b;
+    return a;
 }
 
-rbnode* delete_node_recursive(rbnode *root, mydata *data, int (*compare)(const void*, const void*)) {
-    if (root == NULL) return root;
-    int cmp = compare(data, root->data);
-    if (cmp < 0) root->left = delete_node_recursive(root->left, data, compare);
-    else if (cmp > 0) root->right = delete_node_recursive(root->right, data, compare);
-    else {
-        if (root->left == NULL) { rbnode *t = root->right; free(root); return t; }
-        else if (root->right == NULL) { rbnode *t = root->left; free(root); return t; }
-        rbnode *temp = rb_find_min(root->right);
-        root->data = temp->data;
-        root->right = delete_node_recursive(root->right, temp->data, compare);
+// Standard two-pass merge of a sibling list: meld left to right in pairs,
+// then fold the pairs together from right to left
+static rq_node* ph_merge_pairs(rq_node *first) {
+    rq_node *pairs = NULL;
+    while (first != NULL) {
+        rq_node *a = first;
+        rq_node *b = a->ph.sibling;
+        first = (b != NULL) ? b->ph.sibling : NULL;
+        a->ph.sibling = NULL;
+        a->ph.prev = NULL;
+        if (b != NULL) {
+            b->ph.sibling = NULL;
+            b->ph.prev = NULL;
+            a = ph_meld(a, b);
+        }
+        a->ph.sibling = pairs;   // pairs is kept in reverse order
+        pairs = a;
+    }
+    if (pairs == NULL) return NULL;
+
+    rq_node *result = pairs;
+    pairs = pairs->ph.sibling;
+    result->ph.sibling = NULL;
+    while (pairs != NULL) {
+        rq_node *next = pairs->ph.sibling;
+        pairs->ph.sibling = NULL;
+        result = ph_meld(result, pairs);
+        pairs = next;
     }
+    result->ph.prev = NULL;
+    return result;
+}
+
+static void ph_init(run_queue *rq) {
+    rq->ph.root = NULL;
+}
+
+static void ph_destroy(run_queue *rq) {
+    (void)rq;
+}
+
+static void ph_insert(run_queue *rq, rq_node *node) {
+    node->ph.child = node->ph.sibling = node->ph.prev = NULL;
+    rq->ph.root = (rq->ph.root == NULL) ? node : ph_meld(rq->ph.root, node);
+}
+
+static rq_node* ph_peek_min(run_queue *rq) {
+    return rq->ph.root;
+}
+
+static rq_node* ph_pop_min(run_queue *rq) {
+    rq_node *root = rq->ph.root;
+    if (root != NULL) rq->ph.root = ph_merge_pairs(root->ph.child);
     return root;
 }
 
-void rb_delete(rbtree *tree, rbnode *node) {
-    if (tree && node) tree->root = delete_node_recursive(tree->root, node->data, tree->compare);
+static void ph_remove(run_queue *rq, rq_node *node) {
+    if (node == rq->ph.root) {
+        ph_pop_min(rq);
+        return;
+    }
+    // Cut the node's subtree out of its sibling list, then meld its merged
+    // children back into the root
+    if (node->ph.prev->ph.child == node) node->ph.prev->ph.child = node->ph.sibling;
+    else node->ph.prev->ph.sibling = node->ph.sibling;
+    if (node->ph.sibling != NULL) node->ph.sibling->ph.prev = node->ph.prev;
+
+    rq_node *children = ph_merge_pairs(node->ph.child);
+    if (children != NULL) rq->ph.root = ph_meld(rq->ph.root, children);
+}
+
+static void ph_update_key(run_queue *rq, rq_node *node, uint64_t key) {
+    ph_remove(rq, node);
+    node->key = key;
+    node->seq = rq->next_seq++;
+    ph_insert(rq, node);
+}
+
+static int ph_validate_subtree(rq_node *node, rq_node *parent) {
+    int count = 0;
+    rq_node *prev = parent;
+    for (; node != NULL; prev = node, node = node->ph.sibling) {
+        if (node->ph.prev != prev) {
+            printf("ph_validate: bad prev pointer\n");
+            return -1;
+        }
+        if (rq_node_before(node, parent)) {
+            printf("ph_validate: child ordered before its parent\n");
+            return -1;
+        }
+        int sub = ph_validate_subtree(node->ph.child, node);
+        if (sub < 0) return -1;
+        count += sub + 1;
+    }
+    return count;
+}
+
+static int ph_validate(run_queue *rq) {
+    rq_node *root = rq->ph.root;
+    if (root == NULL) return 0;
+    if (root->ph.prev != NULL || root->ph.sibling != NULL) {
+        printf("ph_validate: root has a prev or sibling link\n");
+        return -1;
+    }
+    int count = ph_validate_subtree(root->ph.child, root);
+    return count < 0 ? -1 : count + 1;
+}
+
+// --- 4-ary implicit heap: nodes remember their array slot, so remove and
+// update-key are O(log n) sifts ---
+
+#define DARY_INITIAL_CAPACITY 64
+
+static void dary_place(run_queue *rq, rq_node *node, int index) {
+    rq->dary.heap[index] = node;
+    node->heap_index = index;
+}
+
+static void dary_sift_up(run_queue *rq, int index) {
+    rq_node *node = rq->dary.heap[index];
+    while (index > 0) {
+        int parent = (index - 1) / DARY_ARITY;
+        if (!rq_node_before(node, rq->dary.heap[parent])) break;
+        dary_place(rq, rq->dary.heap[parent], index);
+        index = parent;
+    }
+    dary_place(rq, node, index);
+}
+
+static void dary_sift_down(run_queue *rq, int index) {
+    rq_node *node = rq->dary.heap[index];
+    int size = rq->dary.size;
+    for (;;) {
+        int first = index * DARY_ARITY + 1;
+        if (first >= size) break;
+        int last = first + DARY_ARITY < size ? first + DARY_ARITY : size;
+        int best = first;
+        for (int c = first + 1; c < last; c++)
+            if (rq_node_before(rq->dary.heap[c], rq->dary.heap[best])) best = c;
+        if (!rq_node_before(rq->dary.heap[best], node)) break;
+        dary_place(rq, rq->dary.heap[best], index);
+        index = best;
+    }
+    dary_place(rq, node, index);
+}
+
+static void dary_init(run_queue *rq) {
+    rq->dary.size = 0;
+    rq->dary.capacity = DARY_INITIAL_CAPACITY;
+    rq->dary.heap = (rq_node**)malloc(rq->dary.capacity * sizeof(rq_node*));
+}
+
+static void dary_destroy(run_queue *rq) {
+    free(rq->dary.heap);
+    rq->dary.heap = NULL;
+}
+
+static void dary_insert(run_queue *rq, rq_node *node) {
+    if (rq->dary.size == rq->dary.capacity) {
+        rq->dary.capacity *= 2;
+        rq->dary.heap = (rq_node**)realloc(rq->dary.heap, rq->dary.capacity * sizeof(rq_node*));
+        if (rq->dary.heap == NULL) {
+            printf("Error: out of memory growing the run queue\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    dary_place(rq, node, rq->dary.size++);
+    dary_sift_up(rq, node->heap_index);
+}
+
+static rq_node* dary_peek_min(run_queue *rq) {
+    return rq->dary.size > 0 ? rq->dary.heap[0] : NULL;
+}
+
+static void dary_remove(run_queue *rq, rq_node *node) {
+    int index = node->heap_index;
+    rq_node *last = rq->dary.heap[--rq->dary.size];
+    if (last == node) return;
+    dary_place(rq, last, index);
+    if (index > 0 && rq_node_before(last, rq->dary.heap[(index - 1) / DARY_ARITY]))
+        dary_sift_up(rq, index);
+    else
+        dary_sift_down(rq, index);
+}
+
+static rq_node* dary_pop_min(run_queue *rq) {
+    rq_node *node = dary_peek_min(rq);
+    if (node != NULL) dary_remove(rq, node);
+    return node;
+}
+
+static void dary_update_key(run_queue *rq, rq_node *node, uint64_t key) {
+    node->key = key;
+    node->seq = rq->next_seq++;
+    int index = node->heap_index;
+    if (index > 0 && rq_node_before(node, rq->dary.heap[(index - 1) / DARY_ARITY]))
+        dary_sift_up(rq, index);
+    else
+        dary_sift_down(rq, index);
+}
+
+static int dary_validate(run_queue *rq) {
+    for (int i = 0; i < rq->dary.size; i++) {
+        if (rq->dary.heap[i]->heap_index != i) {
+            printf("dary_validate: stale heap index at slot %d\n", i);
+            return -1;
+        }
+        if (i > 0 && rq_node_before(rq->dary.heap[i], rq->dary.heap[(i - 1) / DARY_ARITY])) {
+            printf("dary_validate: heap order violated at slot %d\n", i);
+            return -1;
+        }
+    }
+    return rq->dary.size;
+}
+
+// --- Bucketed radix queue (radix heap) keyed on vruntime. Bucket 0 holds
+// keys equal to `last`, the last extracted minimum; bucket b holds keys whose
+// highest bit differing from `last` is bit b-1. Extraction refills bucket 0
+// by redistributing the lowest non-empty bucket, so each node moves to a
+// strictly lower bucket at most 64 times. Bucket 0 is kept in seq order.
+// Keys below `last` (waking tasks with sleeper credit, migrated tasks) go
+// to a separate underflow list sorted by (key, seq), which is served first. ---
+
+static int radix_bucket_of(uint64_t key, uint64_t last) {
+    return key == last ? 0 : 64 - __builtin_clzll(key ^ last);
+}
+
+static void radix_unlink(run_queue *rq, rq_node *node) {
+    int b = node->rx.bucket;
+    if (node->rx.prev != NULL) node->rx.prev->rx.next = node->rx.next;
+    else rq->radix.head[b] = node->rx.next;
+    if (node->rx.next != NULL) node->rx.next->rx.prev = node->rx.prev;
+    else rq->radix.tail[b] = node->rx.prev;
+    if (b > 0 && b < RADIX_UNDERFLOW && rq->radix.head[b] == NULL)
+        rq->radix.nonempty &= ~(1ULL << (b - 1));
+}
+
+static void radix_append(run_queue *rq, rq_node *node, int b) {
+    node->rx.bucket = b;
+    node->rx.next = NULL;
+    node->rx.prev = rq->radix.tail[b];
+    if (rq->radix.tail[b] != NULL) rq->radix.tail[b]->rx.next = node;
+    else rq->radix.head[b] = node;
+    rq->radix.tail[b] = node;
+    if (b > 0) rq->radix.nonempty |= 1ULL << (b - 1);
+}
+
+// Insert into a sorted list (bucket 0 or the underflow list), walking back
+// from the tail. New inserts carry the largest seq and mostly the largest
+// key, so they usually append.
+static void radix_insert_sorted(run_queue *rq, rq_node *node, int b) {
+    rq_node *after = rq->radix.tail[b];
+    while (after != NULL && rq_node_before(node, after)) after = after->rx.prev;
+    node->rx.bucket = b;
+    node->rx.prev = after;
+    node->rx.next = (after != NULL) ? after->rx.next : rq->radix.head[b];
+    if (node->rx.next != NULL) node->rx.next->rx.prev = node;
+    else rq->radix.tail[b] = node;
+    if (after != NULL) after->rx.next = node;
+    else rq->radix.head[b] = node;
+}
+
+static void radix_place(run_queue *rq, rq_node *node) {
+    int b = radix_bucket_of(node->key, rq->radix.last);
+    if (b == 0) radix_insert_sorted(rq, node, 0);
+    else radix_append(rq, node, b);
+}
+
+static void radix_init(run_queue *rq) {
+    memset(&rq->radix, 0, sizeof(rq->radix));
+}
+
+static void radix_destroy(run_queue *rq) {
+    (void)rq;
+}
+
+static void radix_insert(run_queue *rq, rq_node *node) {
+    if (node->key < rq->radix.last) radix_insert_sorted(rq, node, RADIX_UNDERFLOW);
+    else radix_place(rq, node);
+}
+
+// `last` only moves while the underflow list is empty, so its keys stay
+// below every bucketed key
+static rq_node* radix_peek_min(run_queue *rq) {
+    if (rq->radix.head[RADIX_UNDERFLOW] != NULL) return rq->radix.head[RADIX_UNDERFLOW];
+    if (rq->radix.head[0] == NULL && rq->radix.nonempty != 0) {
+        int b = __builtin_ctzll(rq->radix.nonempty) + 1;
+        rq_node *node = rq->radix.head[b];
+        uint64_t min = node->key;
+        for (; node != NULL; node = node->rx.next)
+            if (node->key < min) min = node->key;
+
+        node = rq->radix.head[b];
+        rq->radix.head[b] = rq->radix.tail[b] = NULL;
+        rq->radix.nonempty &= ~(1ULL << (b - 1));
+        rq->radix.last = min;
+        while (node != NULL) {
+            rq_node *next = node->rx.next;
+            radix_place(rq, node);
+            node = next;
+        }
+    }
+    return rq->radix.head[0];
+}
+
+static void radix_remove(run_queue *rq, rq_node *node) {
+    radix_unlink(rq, node);
+}
+
+static rq_node* radix_pop_min(run_queue *rq) {
+    rq_node *node = radix_peek_min(rq);
+    if (node != NULL) radix_unlink(rq, node);
+    return node;
+}
+
+static void radix_update_key(run_queue *rq, rq_node *node, uint64_t key) {
+    radix_unlink(rq, node);
+    node->key = key;
+    node->seq = rq->next_seq++;
+    radix_insert(rq, node);
+}
+
+static int radix_validate(run_queue *rq) {
+    int count = 0;
+    for (int b = 0; b <= RADIX_UNDERFLOW; b++) {
+        if (b > 0 && b < RADIX_UNDERFLOW && ((rq->radix.nonempty >> (b - 1)) & 1) != (rq->radix.head[b] != NULL)) {
+            printf("radix_validate: occupancy bit wrong for bucket %d\n", b);
+            return -1;
+        }
+        rq_node *prev = NULL;
+        for (rq_node *node = rq->radix.head[b]; node != NULL; prev = node, node = node->rx.next) {
+            if (node->rx.prev != prev || node->rx.bucket != b) {
+                printf("radix_validate: bad links in bucket %d\n", b);
+                return -1;
+            }
+            if (b == RADIX_UNDERFLOW ? node->key >= rq->radix.last
+                                     : radix_bucket_of(node->key, rq->radix.last) != b) {
+                printf("radix_validate: node in the wrong bucket %d\n", b);
+                return -1;
+            }
+            if ((b == 0 || b == RADIX_UNDERFLOW) && prev != NULL && rq_node_before(node, prev)) {
+                printf("radix_validate: sorted list %d out of order\n", b);
+                return -1;
+            }
+            count++;
+        }
+        if (rq->radix.tail[b] != prev) {
+            printf("radix_validate: stale tail in bucket %d\n", b);
+            return -1;
+        }
+    }
+    return count;
+}
+
+static const rq_ops rq_engines[] = {
+    { "rbtree",  rbq_init,   rbq_destroy,   rbq_insert,   rbq_peek_min,   rbq_pop_min,
+      rbq_remove,   rbq_update_key,   rbq_validate },
+    { "pairing", ph_init,    ph_destroy,    ph_insert,    ph_peek_min,    ph_pop_min,
+      ph_remove,    ph_update_key,    ph_validate },
+    { "dary",    dary_init,  dary_destroy,  dary_insert,  dary_peek_min,  dary_pop_min,
+      dary_remove,  dary_update_key,  dary_validate },
+    { "radix",   radix_init, radix_destroy, radix_insert, radix_peek_min, radix_pop_min,
+      radix_remove, radix_update_key, radix_validate },
+};
+#define RQ_ENGINE_COUNT ((int)(sizeof(rq_engines) / sizeof(rq_engines[0])))
+
+const rq_ops* find_rq_engine(const char *name) {
+    for (int i = 0; i < RQ_ENGINE_COUNT; i++)
+        if (strcmp(rq_engines[i].name, name) == 0) return &rq_engines[i];
+    return NULL;
+}
+
+void rq_init(run_queue *rq, const rq_ops *ops) {
+    rq->ops = ops;
+    rq->next_seq = 0;
+    ops->init(rq);
+}
+
+void rq_destroy(run_queue *rq) {
+    rq->ops->destroy(rq);
+}
+
+void rq_insert(run_queue *rq, rq_node *node, uint64_t key) {
+    node->key = key;
+    node->seq = rq->next_seq++;
+    rq->ops->insert(rq, node);
+}
+
+rq_node* rq_peek_min(run_queue *rq) {
+    return rq->ops->peek_min(rq);
+}
+
+rq_node* rq_pop_min(run_queue *rq) {
+    return rq->ops->pop_min(rq);
+}
+
+void rq_remove(run_queue *rq, rq_node *node) {
+    rq->ops->remove(rq, node);
+}
+
+void rq_update_key(run_queue *rq, rq_node *node, uint64_t key) {
+    rq->ops->update_key(rq, node, key);
 }
 
 // ==========================================
 // PART 3: SCHEDULER LOGIC (EXERCISE AREA)
 // ==========================================
 
-int compare_func(const void *left, const void *right) {
-    int l = ((mydata *)left)->key;
-    int r = ((mydata *)right)->key;
-    return (l - r);
+// Keys are compared through a signed difference, like the kernel's
+// entity_before(), so ordering stays correct even if vruntime ever wraps.
+// Equal keys fall back to enqueue order.
+int compare_func(const rbnode *left, const rbnode *right) {
+    const rq_node *l = rb_entry(left, rq_node, rb);
+    const rq_node *r = rb_entry(right, rq_node, rb);
+    int64_t diff = (int64_t)(l->key - r->key);
+    if (diff == 0) return (l->seq > r->seq) - (l->seq < r->seq);
+    return (diff > 0) - (diff < 0);
+}
+
+int get_process_nice(int process_id) {
+    if (process_id % 2 == 0) return -5;   // High Priority (weight 3121)
+    return 0;                             // Normal Priority (weight 1024)
 }
 
-int get_process_weight(int process_id) {
-    if (process_id % 2 == 0) return 3072; // High Priority
-    return 1024;                          // Normal Priority
+// (a * mul) >> shift without a 128-bit multiply; shift must be <= 32
+static inline uint64_t mul_u64_u32_shr(uint64_t a, uint32_t mul, unsigned int shift) {
+    uint64_t lo = ((uint64_t)(uint32_t)a * mul) >> shift;
+    uint64_t hi = (uint64_t)(uint32_t)(a >> 32) * mul;
+    return lo + (hi << (32 - shift));
 }
 
 // students_task1: Implement the logic to calculate how much vruntime increases.
-// Formula hint: delta = (time * NICE_0_LOAD * x?) / weight
-int calculate_vruntime_delta(int actual_runtime_ticks, int weight) {
+// Formula: delta = time * NICE_0_LOAD / weight
+uint64_t calculate_vruntime_delta(int actual_runtime_ticks, const load_weight *lw) {
     // Delta vruntime is inversely proportional to the weight.
     // Higher weight (priority) = smaller delta = runs more often.
-    return (actual_runtime_ticks * NICE_0_LOAD) / weight;
+    // Dividing by weight is a multiply by inv_weight = 2^32 / weight, and
+    // multiplying by NICE_0_LOAD = 2^10 folds into the shift.
+    uint64_t delta_exec = (uint64_t)actual_runtime_ticks * TICK_NS;
+    if (lw->weight == NICE_0_LOAD) return delta_exec;
+    return mul_u64_u32_shr(delta_exec, lw->inv_weight, WMULT_SHIFT - NICE_0_SHIFT);
 }
 
-void fill_process_array(process* process_array[PROCESS_COUNT]){
+// The same scaling for an arbitrary span of real nanoseconds
+uint64_t calc_delta_fair(uint64_t delta_exec, const load_weight *lw) {
+    if (lw->weight == NICE_0_LOAD) return delta_exec;
+    return mul_u64_u32_shr(delta_exec, lw->inv_weight, WMULT_SHIFT - NICE_0_SHIFT);
+}
+
+void fill_process_array(process_pool *pool, process* process_array[PROCESS_COUNT]){
     for(int i = 0; i < PROCESS_COUNT; i++)
-        process_array[i] = create_process(1000 + i, 0, 10 + i);
+        process_array[i] = create_process(pool, 1000 + i, get_process_nice(1000 + i), 0, 10 + i);
 }
 
-void insert_one_process_to_rbtree(rbtree *rbt, process* proc){
-    // students_task2: Create 'mydata' using proc->vruntime as key and insert into tree
-    mydata *data = makedata_with_object(proc->vruntime, proc);
-    rb_insert(rbt, data);
+void insert_one_process(run_queue *rq, process* proc){
+    // students_task2: Link the process's embedded node, keyed by se.vruntime
+    rq_insert(rq, &proc->se.run_node, proc->se.vruntime);
 }
 
-process* process_of_node(rbnode* node){
-    return (process *)((mydata *)(node->data))->object;
+process* process_of_node(rq_node* node){
+    return rb_entry(node, process, se.run_node);
 }
 
-int main(){
-    process *processes[PROCESS_COUNT];
-    fill_process_array(processes);
+sched_entity* se_of_node(rq_node *node) {
+    return rb_entry(node, sched_entity, run_node);
+}
 
-    rbtree *rbt = rb_create(compare_func);
-    
-    // Initial insertion
-    for(int i = 0; i < PROCESS_COUNT; i++)
-        insert_one_process_to_rbtree(rbt, processes[i]);
-
-    rbnode *node;
-    process *current_proc;
-    int current_tick = 0;
-    int weight, v_delta;
-
-    // Loop until tree is empty
-    while ((node = RB_MINIMAL(rbt))) {
-        printf("\n--- Tick %d ---\n", current_tick++);
-
-        // students_task3: Extract process from the node
-        current_proc = process_of_node(node);
-        
-        weight = get_process_weight(current_proc->id);
-        printf("Running Process %d (Weight: %d, Vruntime: %d)\n", 
-               current_proc->id, weight, current_proc->vruntime);
-
-        run_process_for_one_tick(current_proc);
-
-        // students_task4: Calculate delta and update vruntime
-        // We ran for 1 tick
-        v_delta = calculate_vruntime_delta(1, weight);
-        current_proc->vruntime += v_delta;
-        
-        printf("  -> New Vruntime: %d\n", current_proc->vruntime);
-
-        // students_task5: Re-schedule logic
-        // 1. Remove current node from tree (it has the old key)
-        rb_delete(rbt, node);
-
-        // 2. If process is NOT terminated, re-insert it (with the new vruntime key)
-        if (!is_terminated(current_proc)) {
-            insert_one_process_to_rbtree(rbt, current_proc);
-        } else {
-            printf("  -> Process %d Finished.\n", current_proc->id);
-        }
+static inline int entity_is_task(const sched_entity *se) {
+    return se->my_q == NULL;
+}
+
+process* task_of(sched_entity *se) {
+    return rb_entry(se, process, se);
+}
+
+static void list_init(list_node *head) {
+    head->next = head->prev = head;
+}
+
+static void list_add_tail(list_node *node, list_node *head) {
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+static void list_del(list_node *node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+}
+
+void cfs_rq_init(cfs_rq *cfs, const rq_ops *engine) {
+    rq_init(&cfs->tasks_timeline, engine);
+    list_init(&cfs->cfs_tasks);
+    cfs->nr_running = 0;
+    cfs->load_weight = 0;
+    cfs->min_vruntime = 0;
+    cfs->curr = NULL;
+}
+
+void cfs_rq_destroy(cfs_rq *cfs) {
+    rq_destroy(&cfs->tasks_timeline);
+}
+
+// Queue an entity (task or group) and count its weight
+void enqueue_entity(cfs_rq *cfs, sched_entity *se) {
+    rq_insert(&cfs->tasks_timeline, &se->run_node, se->vruntime);
+    if (entity_is_task(se)) list_add_tail(&se->group_node, &cfs->cfs_tasks);
+    cfs->nr_running++;
+    cfs->load_weight += se->load.weight;
+    se->on_rq = 1;
+}
+
+// Remove an entity and its weight. The running entity is already off the tree.
+void dequeue_entity(cfs_rq *cfs, sched_entity *se) {
+    if (se == cfs->curr) cfs->curr = NULL;
+    else rq_remove(&cfs->tasks_timeline, &se->run_node);
+    if (entity_is_task(se)) list_del(&se->group_node);
+    cfs->nr_running--;
+    cfs->load_weight -= se->load.weight;
+    se->on_rq = 0;
+}
+
+void enqueue_task(cfs_rq *cfs, process *p) {
+    enqueue_entity(cfs, &p->se);
+}
+
+void dequeue_task(cfs_rq *cfs, process *p) {
+    dequeue_entity(cfs, &p->se);
+}
+
+// min_vruntime only moves forward: it follows the smaller of the running
+// entity and the leftmost queued entity
+void update_min_vruntime(cfs_rq *cfs, sched_entity *curr) {
+    rq_node *leftmost = rq_peek_min(&cfs->tasks_timeline);
+    uint64_t vruntime = cfs->min_vruntime;
+    int have = 0;
+
+    if (curr != NULL) {
+        vruntime = curr->vruntime;
+        have = 1;
     }
+    if (leftmost != NULL) {
+        uint64_t left = se_of_node(leftmost)->vruntime;
+        if (!have || (int64_t)(left - vruntime) < 0) vruntime = left;
+        have = 1;
+    }
+    if (have && (int64_t)(vruntime - cfs->min_vruntime) > 0) cfs->min_vruntime = vruntime;
+}
+
+// Give an entity that becomes runnable a vruntime relative to min_vruntime.
+// A new entity starts at min_vruntime, so a late arrival cannot hold the CPU
+// until it catches up from 0. A waking entity keeps its own vruntime unless
+// it has fallen behind, and then gets at most SLEEPER_CREDIT_NS of credit.
+void place_entity(cfs_rq *cfs, sched_entity *se) {
+    uint64_t vruntime = cfs->min_vruntime;
+    if (se->sum_exec_runtime != 0) vruntime -= SLEEPER_CREDIT_NS;
+    if ((int64_t)(se->vruntime - vruntime) < 0) se->vruntime = vruntime;
+}
+
+// Make p runnable: place and queue it, then every ancestor group that was
+// not queued because it had nothing runnable (the kernel's
+// enqueue_task_fair). Returns the number of entities queued.
+int enqueue_task_fair(process *p) {
+    int queued = 0;
+    for (sched_entity *se = &p->se; se != NULL && !se->on_rq; se = se->parent) {
+        place_entity(se->cfs_rq, se);
+        enqueue_entity(se->cfs_rq, se);
+        queued++;
+    }
+    return queued;
+}
+
+// p blocks or exits: dequeue it, then every ancestor group left empty
+void dequeue_task_fair(process *p) {
+    for (sched_entity *se = &p->se; se != NULL; se = se->parent) {
+        cfs_rq *cfs = se->cfs_rq;
+        dequeue_entity(cfs, se);
+        if (cfs->nr_running > 0) break;
+    }
+}
+
+// Take the leftmost entity off the tree to run it; it stays counted
+void set_next_entity(cfs_rq *cfs, sched_entity *se) {
+    rq_remove(&cfs->tasks_timeline, &se->run_node);
+    cfs->curr = se;
+    se->prev_sum_exec_runtime = se->sum_exec_runtime;
+}
+
+// Put the running entity back on the tree under its new vruntime
+void put_prev_entity(cfs_rq *cfs, sched_entity *se) {
+    rq_insert(&cfs->tasks_timeline, &se->run_node, se->vruntime);
+    cfs->curr = NULL;
+}
+
+// Walk down from the root: at each level run the leftmost entity, until
+// that entity is a task. O(depth * log n).
+process* pick_next_task(cfs_rq *root) {
+    cfs_rq *cfs = root;
+    sched_entity *se;
+    do {
+        rq_node *node = rq_peek_min(&cfs->tasks_timeline);
+        if (node == NULL) return NULL;
+        se = se_of_node(node);
+        set_next_entity(cfs, se);
+        cfs = se->my_q;
+    } while (cfs != NULL);
+    return task_of(se);
+}
+
+// Put back every running entity from the task up; the levels where it
+// was dequeued have no curr any more. Returns the number put back.
+int put_prev_task(process *p) {
+    int requeued = 0;
+    for (sched_entity *se = &p->se; se != NULL; se = se->parent) {
+        if (se->cfs_rq->curr == se) {
+            put_prev_entity(se->cfs_rq, se);
+            requeued++;
+        }
+    }
+    return requeued;
+}
+
+// Charge `ticks` ticks to the task and every group above it, each at its
+// own weight, and move each level's min_vruntime forward
+void update_curr(process *p, long ticks) {
+    for (sched_entity *se = &p->se; se != NULL; se = se->parent) {
+        se->sum_exec_runtime += ticks * TICK_NS;
+        se->vruntime += ticks * calculate_vruntime_delta(1, &se->load);
+        update_min_vruntime(se->cfs_rq, se);
+    }
+}
+
+// Groups get their weight from shares, like cpu.shares, instead of nice
+void set_group_shares(task_group *tg, unsigned long shares) {
+    tg->se.load.weight = shares;
+    tg->se.load.inv_weight = (uint32_t)(0xFFFFFFFFULL / shares);
+}
+
+// parent NULL: the group sits on the root queue given to run_cfs
+void init_task_group(task_group *tg, int id, task_group *parent, unsigned long shares,
+                     const rq_ops *engine) {
+    memset(tg, 0, sizeof(*tg));
+    tg->id = id;
+    set_group_shares(tg, shares);
+    cfs_rq_init(&tg->my_q, engine);
+    tg->se.my_q = &tg->my_q;
+    if (parent != NULL) {
+        tg->se.parent = &parent->se;
+        tg->se.cfs_rq = &parent->my_q;
+        tg->se.depth = parent->se.depth + 1;
+    }
+}
+
+void attach_task_group(process *p, task_group *tg) {
+    p->se.parent = &tg->se;
+    p->se.cfs_rq = &tg->my_q;
+    p->se.depth = tg->se.depth + 1;
+}
+
+// ==========================================
+// PART 4: RUN-QUEUE STRESS TEST
+// ==========================================
+
+#define STRESS_DEFAULT_CYCLES 2000000
+#define STRESS_DEFAULT_TASKS  1000
+#define STRESS_CHECK_INTERVAL 10000
+
+static int rb_depth(rbnode *node) {
+    if (node == NULL) return 0;
+    int l = rb_depth(node->left);
+    int r = rb_depth(node->right);
+    return 1 + (l > r ? l : r);
+}
+
+// Usage: ./cfs --stress [cycles] [tasks] [--engine NAME]
+// All tasks start at vruntime 0 and advance in lockstep, which is the shape
+// that degenerated the old unbalanced tree into a list. Every check interval
+// the engine's own invariants are validated and its minimum is compared with
+// a brute-force scan.
+int run_stress_test(int argc, char *argv[], const rq_ops *engine) {
+    long cycles = (argc > 2) ? strtol(argv[2], NULL, 10) : STRESS_DEFAULT_CYCLES;
+    int tasks = (argc > 3) ? (int)strtol(argv[3], NULL, 10) : STRESS_DEFAULT_TASKS;
+    if (cycles <= 0 || tasks <= 0) {
+        printf("Usage: %s --stress [cycles] [tasks] [--engine NAME]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    process_pool pool = {NULL};
+    run_queue rq;
+    rq_init(&rq, engine);
+    process **procs = (process**)malloc(tasks * sizeof(process*));
+    unsigned int seed = 42;
+    for (int i = 0; i < tasks; i++) {
+        procs[i] = create_process(&pool, i, rand_r(&seed) % 40 - 20, 0, 1);
+        insert_one_process(&rq, procs[i]);
+    }
+
+    int max_depth = 0;
+    int status = EXIT_SUCCESS;
+    for (long c = 1; c <= cycles && status == EXIT_SUCCESS; c++) {
+        // Mix every operation: pop the minimum most of the time, sometimes
+        // remove or re-key an arbitrary task so interior nodes get unlinked
+        process *proc;
+        int op = rand_r(&seed) % 8;
+        if (op == 0) {
+            proc = procs[rand_r(&seed) % tasks];
+            rq_remove(&rq, &proc->se.run_node);
+        } else if (op == 1) {
+            proc = NULL;
+        } else {
+            proc = process_of_node(rq_pop_min(&rq));
+        }
+
+        if (proc == NULL) {
+            // Re-key in place, without taking the task out first
+            proc = procs[rand_r(&seed) % tasks];
+            proc->se.vruntime += calculate_vruntime_delta(1, &proc->se.load);
+            rq_update_key(&rq, &proc->se.run_node, proc->se.vruntime);
+        } else {
+            // Mostly lockstep steps, with occasional larger jumps to mix shapes
+            uint64_t delta = calculate_vruntime_delta(1, &proc->se.load);
+            if (rand_r(&seed) % 16 == 0) delta += (rand_r(&seed) % 64) * TICK_NS;
+            proc->se.vruntime += delta;
+            insert_one_process(&rq, proc);
+        }
+
+        if (c % STRESS_CHECK_INTERVAL == 0 || c == cycles) {
+            int count = engine->validate(&rq);
+            if (count != tasks) {
+                printf("FAIL: invariant check after cycle %ld (nodes: %d, expected %d)\n",
+                       c, count, tasks);
+                status = EXIT_FAILURE;
+                break;
+            }
+            rq_node *min = &procs[0]->se.run_node;
+            for (int i = 1; i < tasks; i++)
+                if (rq_node_before(&procs[i]->se.run_node, min)) min = &procs[i]->se.run_node;
+            if (rq_peek_min(&rq) != min) {
+                printf("FAIL: cycle %ld peek_min returned vruntime %llu but the minimum is %llu\n",
+                       c, (unsigned long long)rq_peek_min(&rq)->key, (unsigned long long)min->key);
+                status = EXIT_FAILURE;
+                break;
+            }
+            if (engine == &rq_engines[0]) {
+                int depth = rb_depth(rq.rb.root);
+                if (depth > max_depth) max_depth = depth;
+            }
+        }
+    }
+
+    if (status == EXIT_SUCCESS) {
+        printf("Stress test passed: %ld cycles over %d tasks on the %s engine",
+               cycles, tasks, engine->name);
+        if (engine == &rq_engines[0]) printf(", max depth %d", max_depth);
+        printf("\n");
+    }
+    free(procs);
+    rq_destroy(&rq);
+    pool_destroy(&pool);
+    return status;
+}
+
+// ==========================================
+// PART 5: MULTI-CPU SIMULATION
+// ==========================================
+
+#define SMP_MAX_CPUS          256
+#define SMP_DEFAULT_CPUS      8
+#define SMP_DEFAULT_TASKS     10000
+#define SMP_BALANCE_INTERVAL  16   // ticks between periodic load_balance runs
+#define SMP_IMBALANCE_PCT     125  // busiest must carry 25% more load than us
+
+// Per-CPU state, padded to its own cache lines so CPUs don't false-share
+typedef struct {
+    pthread_mutex_t lock;
+    cfs_rq cfs;
+    int cpu;
+    long busy_ticks;
+    long idle_ticks;
+    long migrations_in;
+    long migrations_out;
+    long completed;
+    // Copies of cfs.nr_running and cfs.load_weight for find_busiest_queue,
+    // which reads them without the lock; stored under the lock whenever a
+    // task leaves or joins this queue for good
+    atomic_int nr_running_snapshot;
+    atomic_long load_snapshot;
+} __attribute__((aligned(64))) cpu_rq;
+
+typedef struct {
+    int nr_cpus;
+    cpu_rq *rqs;
+    pthread_barrier_t barrier;
+    atomic_int tasks_left;
+    int done;
+    long epochs;
+    uint64_t max_drift;
+    double drift_sum;
+    long drift_samples;
+} smp_system;
+
+static void lock_two_rqs(cpu_rq *a, cpu_rq *b) {
+    if (a->cpu < b->cpu) {
+        pthread_mutex_lock(&a->lock);
+        pthread_mutex_lock(&b->lock);
+    } else {
+        pthread_mutex_lock(&b->lock);
+        pthread_mutex_lock(&a->lock);
+    }
+}
+
+static void unlock_two_rqs(cpu_rq *a, cpu_rq *b) {
+    pthread_mutex_unlock(&a->lock);
+    pthread_mutex_unlock(&b->lock);
+}
+
+// Publish rq's counters for the lockless scan. rq->lock must be held.
+static void publish_rq_load(cpu_rq *rq) {
+    atomic_store_explicit(&rq->nr_running_snapshot, rq->cfs.nr_running, memory_order_relaxed);
+    atomic_store_explicit(&rq->load_snapshot, rq->cfs.load_weight, memory_order_relaxed);
+}
+
+// Move one queued task between locked run queues. vruntime is made
+// relative to the source queue and rebased on the destination queue, so a
+// task neither gains nor loses its place by migrating.
+static void migrate_task(process *p, cpu_rq *src, cpu_rq *dst) {
+    dequeue_task(&src->cfs, p);
+    p->se.vruntime = p->se.vruntime - src->cfs.min_vruntime + dst->cfs.min_vruntime;
+    enqueue_task(&dst->cfs, p);
+    src->migrations_out++;
+    dst->migrations_in++;
+    publish_rq_load(src);
+    publish_rq_load(dst);
+}
+
+// Lockless scan for the queue with the most load, over the published
+// snapshots: relaxed loads are enough, as a stale value only picks a worse
+// candidate, and the caller re-checks under the locks before moving anything
+static cpu_rq* find_busiest_queue(smp_system *sys, cpu_rq *this_rq) {
+    cpu_rq *busiest = NULL;
+    long max_load = 0;
+    for (int i = 0; i < sys->nr_cpus; i++) {
+        cpu_rq *rq = &sys->rqs[i];
+        if (rq == this_rq || atomic_load_explicit(&rq->nr_running_snapshot, memory_order_relaxed) < 2)
+            continue;
+        long load = atomic_load_explicit(&rq->load_snapshot, memory_order_relaxed);
+        if (load > max_load) {
+            max_load = load;
+            busiest = rq;
+        }
+    }
+    return busiest;
+}
+
+// Pull queued tasks from the busiest CPU until the load difference is
+// halved, but only when the gap is worth a migration (SMP_IMBALANCE_PCT).
+// Tasks are taken from the tail of cfs_tasks, i.e. the ones that ran there
+// most recently and are furthest from being picked again. Returns tasks moved.
+int load_balance(smp_system *sys, cpu_rq *this_rq) {
+    cpu_rq *busiest = find_busiest_queue(sys, this_rq);
+    if (busiest == NULL) return 0;
+
+    int moved = 0;
+    lock_two_rqs(this_rq, busiest);
+    long imbalance = 0;
+    if (busiest->cfs.load_weight * 100 > this_rq->cfs.load_weight * SMP_IMBALANCE_PCT)
+        imbalance = (busiest->cfs.load_weight - this_rq->cfs.load_weight) / 2;
+    while (imbalance > 0 && busiest->cfs.nr_running > 1) {
+        process *p = rb_entry(busiest->cfs.cfs_tasks.prev, process, se.group_node);
+        long weight = p->se.load.weight;
+        if (weight > imbalance && moved > 0) break;
+        migrate_task(p, busiest, this_rq);
+        imbalance -= weight;
+        moved++;
+    }
+    unlock_two_rqs(this_rq, busiest);
+    return moved;
+}
+
+// Runs on the barrier's serial thread between epochs: samples how far the
+// per-CPU min_vruntime values have drifted apart
+static void sample_vruntime_drift(smp_system *sys) {
+    uint64_t lo = 0, hi = 0;
+    int have = 0;
+    for (int i = 0; i < sys->nr_cpus; i++) {
+        cfs_rq *cfs = &sys->rqs[i].cfs;
+        if (cfs->nr_running == 0) continue;
+        if (!have || cfs->min_vruntime < lo) lo = cfs->min_vruntime;
+        if (!have || cfs->min_vruntime > hi) hi = cfs->min_vruntime;
+        have = 1;
+    }
+    if (!have) return;
+    if (hi - lo > sys->max_drift) sys->max_drift = hi - lo;
+    sys->drift_sum += hi - lo;
+    sys->drift_samples++;
+}
+
+typedef struct {
+    smp_system *sys;
+    cpu_rq *rq;
+} cpu_worker_arg;
+
+// One simulated CPU. Ticks run freely inside an epoch of
+// SMP_BALANCE_INTERVAL ticks; CPUs meet at a barrier between epochs, where
+// every CPU runs the periodic load_balance. A CPU whose queue empties
+// mid-epoch pulls work immediately (idle balance).
+void* cpu_worker(void *arg) {
+    smp_system *sys = ((cpu_worker_arg*)arg)->sys;
+    cpu_rq *rq = ((cpu_worker_arg*)arg)->rq;
+
+    for (;;) {
+        for (int t = 0; t < SMP_BALANCE_INTERVAL; t++) {
+            pthread_mutex_lock(&rq->lock);
+            rq_node *node = rq_peek_min(&rq->cfs.tasks_timeline);
+            if (node == NULL) {
+                pthread_mutex_unlock(&rq->lock);
+                if (atomic_load(&sys->tasks_left) > 0 && load_balance(sys, rq) > 0) {
+                    pthread_mutex_lock(&rq->lock);
+                    node = rq_peek_min(&rq->cfs.tasks_timeline);
+                }
+                if (node == NULL) {
+                    rq->idle_ticks++;
+                    continue;
+                }
+            }
+
+            process *curr = process_of_node(node);
+            dequeue_task(&rq->cfs, curr);
+            run_process_for_one_tick(curr);
+            curr->se.sum_exec_runtime += TICK_NS;
+            curr->se.vruntime += calculate_vruntime_delta(1, &curr->se.load);
+            update_min_vruntime(&rq->cfs, &curr->se);
+            rq->busy_ticks++;
+
+            if (!is_terminated(curr)) {
+                enqueue_task(&rq->cfs, curr);
+            } else {
+                rq->completed++;
+                publish_rq_load(rq);
+                atomic_fetch_sub(&sys->tasks_left, 1);
+            }
+            pthread_mutex_unlock(&rq->lock);
+        }
+
+        if (pthread_barrier_wait(&sys->barrier) == PTHREAD_BARRIER_SERIAL_THREAD) {
+            sys->epochs++;
+            sample_vruntime_drift(sys);
+            sys->done = (atomic_load(&sys->tasks_left) == 0);
+        }
+        pthread_barrier_wait(&sys->barrier);
+        if (sys->done) break;
+
+        load_balance(sys, rq);
+    }
+    return NULL;
+}
+
+// Deterministic mixed workload: every task starts on CPU 0, as after a
+// fork burst, so both idle pulls and periodic balancing have work to do
+void fill_smp_workload(process_pool *pool, cpu_rq *boot_rq, int tasks) {
+    unsigned int seed = 7;
+    for (int i = 0; i < tasks; i++) {
+        process *p = create_process(pool, i, rand_r(&seed) % 11 - 5, 0, 1 + rand_r(&seed) % 200);
+        enqueue_task(&boot_rq->cfs, p);
+    }
+    publish_rq_load(boot_rq);
+}
+
+// Usage: ./cfs --smp [cpus] [tasks] [--engine NAME]
+int run_smp_simulation(int argc, char *argv[], const rq_ops *engine) {
+    int nr_cpus = (argc > 2) ? (int)strtol(argv[2], NULL, 10) : SMP_DEFAULT_CPUS;
+    int tasks = (argc > 3) ? (int)strtol(argv[3], NULL, 10) : SMP_DEFAULT_TASKS;
+    if (nr_cpus <= 0 || nr_cpus > SMP_MAX_CPUS || tasks <= 0) {
+        printf("Usage: %s --smp [cpus 1-%d] [tasks] [--engine NAME]\n", argv[0], SMP_MAX_CPUS);
+        return EXIT_FAILURE;
+    }
+
+    smp_system sys;
+    memset(&sys, 0, sizeof(sys));
+    sys.nr_cpus = nr_cpus;
+    sys.rqs = (cpu_rq*)aligned_alloc(64, nr_cpus * sizeof(cpu_rq));
+    for (int i = 0; i < nr_cpus; i++) {
+        memset(&sys.rqs[i], 0, sizeof(cpu_rq));
+        pthread_mutex_init(&sys.rqs[i].lock, NULL);
+        cfs_rq_init(&sys.rqs[i].cfs, engine);
+        atomic_init(&sys.rqs[i].nr_running_snapshot, 0);
+        atomic_init(&sys.rqs[i].load_snapshot, 0);
+        sys.rqs[i].cpu = i;
+    }
+    pthread_barrier_init(&sys.barrier, NULL, nr_cpus);
+    atomic_init(&sys.tasks_left, tasks);
+
+    process_pool pool = {NULL};
+    fill_smp_workload(&pool, &sys.rqs[0], tasks);
+
+    pthread_t *threads = (pthread_t*)malloc(nr_cpus * sizeof(pthread_t));
+    cpu_worker_arg *args = (cpu_worker_arg*)malloc(nr_cpus * sizeof(cpu_worker_arg));
+    for (int i = 0; i < nr_cpus; i++) {
+        args[i].sys = &sys;
+        args[i].rq = &sys.rqs[i];
+        if (pthread_create(&threads[i], NULL, cpu_worker, &args[i]) != 0) {
+            printf("Failed to create thread for CPU %d\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < nr_cpus; i++)
+        pthread_join(threads[i], NULL);
+
+    long total_ticks = sys.epochs * SMP_BALANCE_INTERVAL;
+    long busy = 0, migrations = 0;
+    printf("\nMulti-CPU CFS simulation: %d CPUs, %d tasks, %ld ticks\n",
+           nr_cpus, tasks, total_ticks);
+    printf("CPU\tBusy\tIdle\tUtil%%\tMigIn\tMigOut\tDone\n");
+    for (int i = 0; i < nr_cpus; i++) {
+        cpu_rq *rq = &sys.rqs[i];
+        printf("%d\t%ld\t%ld\t%.1f\t%ld\t%ld\t%ld\n",
+               i, rq->busy_ticks, rq->idle_ticks,
+               100.0 * rq->busy_ticks / total_ticks,
+               rq->migrations_in, rq->migrations_out, rq->completed);
+        busy += rq->busy_ticks;
+        migrations += rq->migrations_in;
+        pthread_mutex_destroy(&rq->lock);
+        cfs_rq_destroy(&rq->cfs);
+    }
+
+    printf("\nTotal migrations: %ld\n", migrations);
+    printf("Average utilization: %.1f%%\n", 100.0 * busy / ((double)total_ticks * nr_cpus));
+    printf("Throughput: %.3f tasks/tick\n", (double)tasks / total_ticks);
+    printf("min_vruntime drift between CPUs: max %.3f ms, mean %.3f ms\n",
+           sys.max_drift / 1e6, sys.drift_samples ? sys.drift_sum / sys.drift_samples / 1e6 : 0.0);
+
+    pthread_barrier_destroy(&sys.barrier);
+    free(threads);
+    free(args);
+    free(sys.rqs);
+    pool_destroy(&pool);
+    return EXIT_SUCCESS;
+}
+
+// ==========================================
+// PART 6: SINGLE-CPU SIMULATION LOOP
+// ==========================================
+
+// Scheduler events go into a preallocated ring of binary records instead of
+// being printed as they happen. When the ring fills, its oldest block is
+// written out in one call; the rest is flushed when the trace is closed.
+// A text ring prints the records (the demo output) instead of writing them.
+#define TRACE_RING_RECORDS  65536   // 2 MB of records
+#define TRACE_FLUSH_RECORDS 16384   // written out this many at a time
+
+typedef struct {
+    cfs_trace_record *slots;
+    uint64_t head;      // records emitted so far
+    uint64_t tail;      // records flushed so far
+    FILE *out;
+    int text;
+    cfs_trace_tasks tasks;   // weights for the text output
+} trace_ring;
+
+static void trace_ring_alloc(trace_ring *ring, FILE *out, int text) {
+    memset(ring, 0, sizeof(*ring));
+    ring->slots = (cfs_trace_record*)malloc(TRACE_RING_RECORDS * sizeof(cfs_trace_record));
+    if (ring->slots == NULL) {
+        printf("Out of memory for the trace ring\n");
+        exit(EXIT_FAILURE);
+    }
+    ring->out = out;
+    ring->text = text;
+}
+
+// Print the events as text to stdout
+void trace_ring_open_text(trace_ring *ring) {
+    trace_ring_alloc(ring, stdout, 1);
+}
+
+// Write the events as a binary trace file (see cfs_trace_decode.c)
+void trace_ring_open_file(trace_ring *ring, const char *path) {
+    FILE *out = fopen(path, "wb");
+    if (out == NULL) {
+        printf("Cannot open trace file '%s'\n", path);
+        exit(EXIT_FAILURE);
+    }
+    // Blocks are already large; skip stdio's copy
+    setvbuf(out, NULL, _IONBF, 0);
+    trace_ring_alloc(ring, out, 0);
+
+    cfs_trace_header header;
+    memcpy(header.magic, CFS_TRACE_MAGIC, sizeof(header.magic));
+    header.version = CFS_TRACE_VERSION;
+    header.record_size = sizeof(cfs_trace_record);
+    if (fwrite(&header, sizeof(header), 1, out) != 1) {
+        printf("Cannot write trace file '%s'\n", path);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Flush up to count of the oldest records, in at most two runs of slots
+static void trace_ring_flush(trace_ring *ring, uint64_t count) {
+    if (count > ring->head - ring->tail) count = ring->head - ring->tail;
+    while (count > 0) {
+        uint64_t first = ring->tail % TRACE_RING_RECORDS;
+        uint64_t n = TRACE_RING_RECORDS - first;
+        if (n > count) n = count;
+        if (ring->text) {
+            for (uint64_t i = 0; i < n; i++)
+                cfs_trace_print(ring->out, &ring->slots[first + i], &ring->tasks);
+        } else if (fwrite(&ring->slots[first], sizeof(cfs_trace_record), n, ring->out) != n) {
+            printf("Cannot write the trace file\n");
+            exit(EXIT_FAILURE);
+        }
+        ring->tail += n;
+        count -= n;
+    }
+}
+
+static inline void trace_emit(trace_ring *ring, uint32_t type, int pid, uint64_t tick,
+                              uint64_t old_vruntime, uint64_t new_vruntime) {
+    if (ring->head - ring->tail == TRACE_RING_RECORDS) trace_ring_flush(ring, TRACE_FLUSH_RECORDS);
+    cfs_trace_record *r = &ring->slots[ring->head++ % TRACE_RING_RECORDS];
+    r->tick = tick;
+    r->old_vruntime = old_vruntime;
+    r->new_vruntime = new_vruntime;
+    r->pid = pid;
+    r->type = type;
+}
+
+void trace_ring_close(trace_ring *ring) {
+    trace_ring_flush(ring, ring->head - ring->tail);
+    if (ring->text) fflush(ring->out);
+    else fclose(ring->out);
+    cfs_trace_tasks_free(&ring->tasks);
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+typedef struct {
+    int fast_forward;   // charge a whole run in one step instead of one tick per pick
+    trace_ring *trace;  // NULL: no per-event output, and no stdio in the loop
+    uint64_t sched_latency_ns;         // 0: legacy mode, pick again after every tick
+    uint64_t min_granularity_ns;
+    uint64_t wakeup_granularity_ns;
+    timeline_writer *timeline;         // NULL: no Gantt timeline
+} sim_options;
+
+typedef struct {
+    long ticks;
+    long idle_ticks;
+    long picks;
+    long context_switches;
+    long tree_ops;
+    long wakeups;       // arrivals plus wakeups from sleep
+    long sleeps;
+    long wakeup_preemptions;
+    // Latency distributions in ticks, recorded as the run goes; fixed size,
+    // so recording never allocates
+    latency_hist wakeup_latency;    // per arrival or wakeup: until first picked
+    latency_hist wait;              // per task: runnable but not running
+    latency_hist response;          // per task: arrival until first run
+    latency_hist turnaround;        // per task: arrival until exit
+} sim_stats;
+
+// Percentile table of every latency distribution of a run
+void sim_stats_latency_report(const sim_stats *st) {
+    latency_hist_print_header("Latency (ticks)");
+    latency_hist_print("Wakeup latency", &st->wakeup_latency);
+    latency_hist_print("Waiting time", &st->wait);
+    latency_hist_print("Response time", &st->response);
+    latency_hist_print("Turnaround time", &st->turnaround);
+}
+
+// How many ticks curr would keep winning the per-tick pick: at every level
+// of the hierarchy, until the running entity's vruntime reaches the key of
+// the leftmost entity beside it (equal keys go right, so a tie hands over
+// the CPU), or until curr terminates. Always at least one.
+long ticks_until_preempt(process *curr) {
+    long ticks = curr->residual_duration;
+    for (sched_entity *se = &curr->se; se != NULL; se = se->parent) {
+        rq_node *next = rq_peek_min(&se->cfs_rq->tasks_timeline);
+        if (next == NULL) continue;
+        uint64_t delta = calculate_vruntime_delta(1, &se->load);
+        uint64_t gap = se_of_node(next)->vruntime - se->vruntime;
+        long until = 1;
+        if ((int64_t)gap > 0) until = (long)((gap + delta - 1) / delta);
+        if (until < ticks) ticks = until;
+    }
+    return ticks > 0 ? ticks : 1;
+}
+
+// The period in which every runnable task should run once. It stretches
+// past sched_latency when the tasks would otherwise get less than
+// min_granularity each, like the kernel's __sched_period.
+uint64_t sched_period(const sim_options *opt, long nr_running) {
+    if (opt->min_granularity_ns > 0 &&
+        (uint64_t)nr_running > opt->sched_latency_ns / opt->min_granularity_ns)
+        return nr_running * opt->min_granularity_ns;
+    return opt->sched_latency_ns;
+}
+
+// curr's share of the period: its weight's share of its own queue, times
+// its group's share of the queue above, and so on up to the root. The
+// running entities stay counted in their queues' load.
+uint64_t sched_slice(process *curr, const sim_options *opt) {
+    uint64_t slice = sched_period(opt, curr->se.cfs_rq->nr_running);
+    for (sched_entity *se = &curr->se; se != NULL; se = se->parent)
+        slice = (uint64_t)((unsigned __int128)slice * se->load.weight / se->cfs_rq->load_weight);
+    return slice;
+}
+
+// Ticks curr may still run before its slice is used up; the slice is
+// checked at tick boundaries, so a task always runs at least one tick
+static long slice_ticks_left(process *curr, const sim_options *opt) {
+    uint64_t ran = curr->se.sum_exec_runtime - curr->se.prev_sum_exec_runtime;
+    uint64_t slice = sched_slice(curr, opt);
+    if (ran >= slice) return 0;
+    return (long)((slice - ran + TICK_NS - 1) / TICK_NS);
+}
+
+// Walk both entities up until they are queued on the same queue, so their
+// vruntimes are comparable (the kernel's find_matching_se)
+static void find_matching_se(sched_entity **se, sched_entity **pse) {
+    while ((*se)->depth > (*pse)->depth) *se = (*se)->parent;
+    while ((*pse)->depth > (*se)->depth) *pse = (*pse)->parent;
+    while ((*se)->cfs_rq != (*pse)->cfs_rq) {
+        *se = (*se)->parent;
+        *pse = (*pse)->parent;
+    }
+}
+
+// A waking task preempts curr only if, where their ancestors meet, it is
+// more than the wakeup granularity (in its own virtual time) behind, like
+// the kernel's wakeup_preempt_entity
+static int wakeup_preempt(process *curr, process *p, const sim_options *opt) {
+    sched_entity *se = &curr->se, *pse = &p->se;
+    find_matching_se(&se, &pse);
+    int64_t vdiff = (int64_t)(se->vruntime - pse->vruntime);
+    return vdiff > (int64_t)calc_delta_fair(opt->wakeup_granularity_ns, &pse->load);
+}
+
+// Turnaround and waiting time of a task that has just exited. Every CPU
+// burst but the last is followed by exactly io_ticks asleep, so what is
+// left of the turnaround after running and sleeping was spent runnable.
+static void record_exit_latency(const process *p, sim_stats *st) {
+    long turnaround = p->finish_tick - p->arrival_tick;
+    long ran = (long)(p->se.sum_exec_runtime / TICK_NS);
+    long slept = 0;
+    if (p->cpu_burst > 0 && ran > 0) slept = (ran - 1) / p->cpu_burst * (long)p->io_ticks;
+    latency_hist_record(&st->turnaround, turnaround);
+    latency_hist_record(&st->wait, turnaround - ran - slept);
+}
+
+// Move every task whose arrival or wakeup is due from the sleep queue onto
+// the run queue, placed relative to min_vruntime. Returns whether one of
+// them should preempt curr.
+static int wake_sleepers(run_queue *sleepers, process *curr, long now,
+                         const sim_options *opt, sim_stats *st) {
+    rq_node *node;
+    int preempt = 0;
+    while ((node = rq_peek_min(sleepers)) != NULL && (long)node->key <= now) {
+        rq_pop_min(sleepers);
+        process *p = process_of_node(node);
+        int arriving = (p->se.sum_exec_runtime == 0);
+        p->runnable_since = now;
+        st->tree_ops += 1 + enqueue_task_fair(p);
+        st->wakeups++;
+        if (curr != NULL && !preempt && wakeup_preempt(curr, p, opt)) preempt = 1;
+        if (opt->trace)
+            trace_emit(opt->trace, arriving ? CFS_TRACE_ARRIVE : CFS_TRACE_WAKE, p->id,
+                       (uint64_t)now, 0, p->se.vruntime);
+    }
+    return preempt;
+}
+
+// Run every task to completion. Tasks with a later arrival_tick, and tasks
+// asleep between CPU bursts, wait on a sleep queue keyed by wakeup tick.
+// Tasks (and groups) without a parent group are queued on cfs; grouped
+// tasks are picked by walking down from cfs through their groups.
+//
+// A picked task runs until its slice (sched_slice) is used up, it blocks or
+// finishes, or a waking task is far enough behind it to preempt. With
+// sched_latency_ns = 0 every tick ends the slice, as in the original
+// one-tick model. Per-tick mode still steps one tick at a time and checks
+// the slice after each; fast_forward charges every tick up to the next
+// slice end, block or wakeup at once, which gives the same schedule.
+void run_cfs(cfs_rq *cfs, process **procs, int tasks, const sim_options *opt, sim_stats *st) {
+    process *current_proc = NULL, *prev_proc = NULL;
+    long current_tick = 0;
+    long ticks;
+    run_queue sleepers;
+
+    memset(st, 0, sizeof(*st));
+    rq_init(&sleepers, cfs->tasks_timeline.ops);
+
+    // Initial insertion
+    for (int i = 0; i < tasks; i++) {
+        process *p = procs[i];
+        sched_entity *top = &p->se;
+        while (top->parent != NULL) top = top->parent;
+        if (top->cfs_rq == NULL) top->cfs_rq = cfs;
+        p->burst_left = p->cpu_burst;
+        if (opt->trace)
+            trace_emit(opt->trace, CFS_TRACE_TASK, p->id, 0, p->se.load.weight,
+                       calculate_vruntime_delta(1, &p->se.load));
+        if (p->arrival_tick > 0) {
+            rq_insert(&sleepers, &p->se.run_node, (uint64_t)p->arrival_tick);
+        } else {
+            p->runnable_since = 0;
+            enqueue_task_fair(p);
+        }
+    }
+
+    for (;;) {
+        if (wake_sleepers(&sleepers, current_proc, current_tick, opt, st)) {
+            // Wakeup preemption: curr goes back behind the wakee
+            st->tree_ops += put_prev_task(current_proc);
+            st->wakeup_preemptions++;
+            current_proc = NULL;
+        }
+
+        if (current_proc == NULL) {
+            // students_task3: Walk down from the root to the leftmost task.
+            // students_task5 (part 1): Each level's node is unlinked before
+            // its key changes.
+            current_proc = pick_next_task(cfs);
+
+            // Nothing runnable: jump the clock to the next arrival or wakeup
+            if (current_proc == NULL) {
+                rq_node *next = rq_peek_min(&sleepers);
+                if (next == NULL) break;
+                st->idle_ticks += (long)next->key - current_tick;
+                current_tick = (long)next->key;
+                continue;
+            }
+
+            st->tree_ops += current_proc->se.depth + 1;
+            st->picks++;
+            if (current_proc != prev_proc) st->context_switches++;
+            prev_proc = current_proc;
+
+            if (current_proc->runnable_since >= 0) {
+                latency_hist_record(&st->wakeup_latency, current_tick - current_proc->runnable_since);
+                if (current_proc->se.sum_exec_runtime == 0)
+                    latency_hist_record(&st->response, current_tick - current_proc->arrival_tick);
+                current_proc->runnable_since = -1;
+            }
+        }
+
+        ticks = 1;
+        if (opt->fast_forward) {
+            if (opt->sched_latency_ns == 0) {
+                ticks = ticks_until_preempt(current_proc);
+            } else {
+                long left = slice_ticks_left(current_proc, opt);
+                ticks = current_proc->residual_duration;
+                if (left < ticks) ticks = left > 0 ? left : 1;
+            }
+            if (current_proc->cpu_burst > 0 && current_proc->burst_left < ticks)
+                ticks = current_proc->burst_left;
+            rq_node *next = rq_peek_min(&sleepers);
+            if (next != NULL && (long)next->key - current_tick < ticks)
+                ticks = (long)next->key - current_tick;
+        }
+
+        // students_task4: Charge the ticks and update vruntime, at every level
+        uint64_t old_vruntime = current_proc->se.vruntime;
+        run_process_for_ticks(current_proc, ticks);
+        update_curr(current_proc, ticks);
+        if (opt->trace)
+            trace_emit(opt->trace, CFS_TRACE_RUN, current_proc->id, (uint64_t)current_tick,
+                       old_vruntime, current_proc->se.vruntime);
+        if (opt->timeline)
+            timeline_add(opt->timeline, (uint64_t)current_tick, (uint64_t)ticks, current_proc->id);
+        current_tick += ticks;
+
+        // students_task5 (part 2): If process is NOT terminated and its slice
+        // is used up, re-link the same node with the new vruntime key;
+        // nothing is allocated or freed
+        if (is_terminated(current_proc)) {
+            current_proc->finish_tick = current_tick;
+            record_exit_latency(current_proc, st);
+            if (opt->trace)
+                trace_emit(opt->trace, CFS_TRACE_EXIT, current_proc->id, (uint64_t)current_tick,
+                           current_proc->se.vruntime, current_proc->se.vruntime);
+            dequeue_task_fair(current_proc);
+            st->tree_ops += put_prev_task(current_proc);
+            current_proc = NULL;
+        } else if (current_proc->cpu_burst > 0 && (current_proc->burst_left -= ticks) == 0) {
+            // End of a CPU burst: sleep on I/O, then come back with a fresh burst
+            current_proc->burst_left = current_proc->cpu_burst;
+            dequeue_task_fair(current_proc);
+            st->tree_ops += put_prev_task(current_proc);
+            rq_insert(&sleepers, &current_proc->se.run_node,
+                      (uint64_t)(current_tick + current_proc->io_ticks));
+            st->sleeps++;
+            st->tree_ops++;
+            if (opt->trace)
+                trace_emit(opt->trace, CFS_TRACE_BLOCK, current_proc->id,
+                           (uint64_t)(current_tick + current_proc->io_ticks),
+                           current_proc->se.vruntime, current_proc->se.vruntime);
+            current_proc = NULL;
+        } else if (opt->sched_latency_ns == 0 || slice_ticks_left(current_proc, opt) == 0) {
+            st->tree_ops += put_prev_task(current_proc);
+            current_proc = NULL;
+        }
+    }
+    st->ticks = current_tick;
+    rq_destroy(&sleepers);
+}
+
+#define SHAPE_MIXED       0   // nice -5..5, 1-200 ticks
+#define SHAPE_LOCKSTEP    1   // all nice 0, 100 ticks: every pick is a tie
+#define SHAPE_WIDE_NICE   2   // nice -20..19, 1-200 ticks
+#define SHAPE_INTERACTIVE 3   // staggered arrivals, a third of the tasks I/O-bound
+#define SHAPE_COUNT       4
+
+static const char *shape_names[SHAPE_COUNT] = { "mixed", "lockstep", "wide-nice", "interactive" };
+
+int find_shape(const char *name) {
+    for (int i = 0; i < SHAPE_COUNT; i++)
+        if (strcmp(shape_names[i], name) == 0) return i;
+    return -1;
+}
+
+// Deterministic generated workloads for benchmark runs
+void fill_random_workload(process_pool *pool, process **procs, int tasks, int shape) {
+    unsigned int seed = 11;
+    for (int i = 0; i < tasks; i++) {
+        int nice = 0, duration = 100;
+        if (shape == SHAPE_MIXED || shape == SHAPE_INTERACTIVE) {
+            duration = 1 + rand_r(&seed) % 200;
+            nice = rand_r(&seed) % 11 - 5;
+        } else if (shape == SHAPE_WIDE_NICE) {
+            duration = 1 + rand_r(&seed) % 200;
+            nice = rand_r(&seed) % 40 - 20;
+        }
+        procs[i] = create_process(pool, i, nice, 0, duration);
+        if (shape == SHAPE_INTERACTIVE) {
+            // Arrivals spread so the CPU is about 90% busy (mean demand ~100 ticks)
+            procs[i]->arrival_tick = rand_r(&seed) % (110L * tasks);
+            if (i % 3 == 0) {
+                procs[i]->cpu_burst = 1 + rand_r(&seed) % 4;
+                procs[i]->io_ticks = 5 + rand_r(&seed) % 36;
+            }
+        }
+    }
+}
+
+// FNV-1a over every task's (id, finish tick, final vruntime). Per-tick and
+// fast-forward runs of the same workload must print the same digest.
+uint64_t task_digest(process **procs, int tasks) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (int i = 0; i < tasks; i++) {
+        uint64_t fields[3] = { (uint64_t)procs[i]->id, (uint64_t)procs[i]->finish_tick,
+                               procs[i]->se.vruntime };
+        for (int f = 0; f < 3; f++) {
+            hash ^= fields[f];
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+static double elapsed_seconds(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// ==========================================
+// PART 7: RUN-QUEUE ENGINE BENCHMARK
+// ==========================================
+
+#define BENCH_DEFAULT_TASKS 20000
+
+// Hardware cache-miss counter for this thread, or -1 where perf events are
+// unavailable (non-Linux, or perf_event_paranoid forbids it)
+static int open_cache_miss_counter(void) {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+static void counter_start(int fd) {
+#ifdef __linux__
+    if (fd < 0) return;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#else
+    (void)fd;
+#endif
+}
+
+static long long counter_stop(int fd) {
+#ifdef __linux__
+    long long count;
+    if (fd < 0) return -1;
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd, &count, sizeof(count)) != sizeof(count)) return -1;
+    return count;
+#else
+    (void)fd;
+    return -1;
+#endif
+}
+
+// Usage: ./cfs --bench-engines [tasks]
+// Runs each workload shape through every engine in per-tick mode (the most
+// run-queue traffic) and reports time per queue operation and cache misses.
+// The task digest must agree across engines.
+int run_engine_benchmark(int argc, char *argv[]) {
+    int tasks = (argc > 2) ? (int)strtol(argv[2], NULL, 10) : BENCH_DEFAULT_TASKS;
+    if (tasks <= 0) {
+        printf("Usage: %s --bench-engines [tasks]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int counter = open_cache_miss_counter();
+    // One-tick slices: the most run-queue traffic per simulated tick
+    sim_options opt = {0, NULL, 0, SCHED_MIN_GRANULARITY_NS, SCHED_WAKEUP_GRANULARITY_NS, NULL};
+    int status = EXIT_SUCCESS;
+    process **procs = (process**)malloc(tasks * sizeof(process*));
+
+    printf("Run-queue engine benchmark: %d tasks, per-tick mode, one-tick slices\n", tasks);
+    printf("Shape\t\tEngine\t\tQueue ops\tTime(s)\tns/op\tCache misses\tDigest\n");
+    for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+        uint64_t expected = 0;
+        for (int e = 0; e < RQ_ENGINE_COUNT; e++) {
+            process_pool pool = {NULL};
+            fill_random_workload(&pool, procs, tasks, shape);
+            cfs_rq cfs;
+            cfs_rq_init(&cfs, &rq_engines[e]);
+
+            sim_stats st;
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            counter_start(counter);
+            run_cfs(&cfs, procs, tasks, &opt, &st);
+            long long misses = counter_stop(counter);
+            double seconds = elapsed_seconds(&start);
+
+            uint64_t digest = task_digest(procs, tasks);
+            if (e == 0) expected = digest;
+            else if (digest != expected) status = EXIT_FAILURE;
+
+            char miss_text[32];
+            if (misses >= 0) snprintf(miss_text, sizeof(miss_text), "%lld", misses);
+            else snprintf(miss_text, sizeof(miss_text), "n/a");
+            printf("%-11s\t%-8s\t%ld\t\t%.3f\t%.1f\t%-12s\t%016llx%s\n",
+                   shape_names[shape], rq_engines[e].name, st.tree_ops, seconds,
+                   seconds * 1e9 / st.tree_ops, miss_text, (unsigned long long)digest,
+                   digest == expected ? "" : "  MISMATCH");
+
+            cfs_rq_destroy(&cfs);
+            pool_destroy(&pool);
+        }
+    }
+
+    if (counter < 0) printf("\n(cache misses need perf events; try perf_event_paranoid <= 2)\n");
+#ifdef __linux__
+    else close(counter);
+#endif
+    free(procs);
+    return status;
+}
+
+// ==========================================
+// PART 8: TIMESLICE TRADEOFF SWEEP
+// ==========================================
+
+#define SWEEP_DEFAULT_TASKS 20000
+
+static const double sweep_latency_ms[] = { 0, 1, 3, 6, 12, 24, 48 };
+static const double sweep_min_gran_ms[] = { 0.75, 3 };
+
+// Usage: ./cfs --sweep-slices [tasks] [workload]
+// Replays one workload (interactive by default) under each sched_latency /
+// min_granularity pair. Longer slices cut context switches but make
+// runnable tasks wait longer; the table shows both sides.
+int run_slice_sweep(int argc, char *argv[]) {
+    int tasks = (argc > 2) ? (int)strtol(argv[2], NULL, 10) : SWEEP_DEFAULT_TASKS;
+    int shape = (argc > 3) ? find_shape(argv[3]) : SHAPE_INTERACTIVE;
+    if (tasks <= 0 || shape < 0) {
+        printf("Usage: %s --sweep-slices [tasks] [workload]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    process **procs = (process**)malloc(tasks * sizeof(process*));
+    int n_lat = sizeof(sweep_latency_ms) / sizeof(sweep_latency_ms[0]);
+    int n_gran = sizeof(sweep_min_gran_ms) / sizeof(sweep_min_gran_ms[0]);
+
+    printf("Timeslice sweep: %d tasks, %s workload, wakeup granularity %.2f ms\n",
+           tasks, shape_names[shape], SCHED_WAKEUP_GRANULARITY_NS / 1e6);
+    printf("Latency(ms)\tMinGran(ms)\tCtx switches\tPer second\tWake preempts\t"
+           "Wake p50\tp90\tp99\tp99.9\tmax (ticks)\n");
+    for (int l = 0; l < n_lat; l++) {
+        for (int g = 0; g < n_gran; g++) {
+            // min_granularity has no effect with one-tick slices
+            if (sweep_latency_ms[l] == 0 && g > 0) continue;
+
+            process_pool pool = {NULL};
+            fill_random_workload(&pool, procs, tasks, shape);
+            cfs_rq cfs;
+            cfs_rq_init(&cfs, &rq_engines[0]);
+            sim_options opt = {1, NULL, (uint64_t)(sweep_latency_ms[l] * 1e6),
+                               (uint64_t)(sweep_min_gran_ms[g] * 1e6), SCHED_WAKEUP_GRANULARITY_NS, NULL};
+            sim_stats st;
+            run_cfs(&cfs, procs, tasks, &opt, &st);
+
+            double sim_seconds = st.ticks * (double)TICK_NS / 1e9;
+            if (sweep_latency_ms[l] == 0) printf("0 (1 tick)\t-\t\t");
+            else printf("%.2f\t\t%.2f\t\t", sweep_latency_ms[l], sweep_min_gran_ms[g]);
+            printf("%ld\t\t%.1f\t\t%ld\t\t%lld\t\t%lld\t%lld\t%lld\t%lld\n",
+                   st.context_switches, st.context_switches / sim_seconds, st.wakeup_preemptions,
+                   latency_hist_percentile(&st.wakeup_latency, 0.50),
+                   latency_hist_percentile(&st.wakeup_latency, 0.90),
+                   latency_hist_percentile(&st.wakeup_latency, 0.99),
+                   latency_hist_percentile(&st.wakeup_latency, 0.999),
+                   st.wakeup_latency.max);
+
+            cfs_rq_destroy(&cfs);
+            pool_destroy(&pool);
+        }
+    }
+    free(procs);
+    return EXIT_SUCCESS;
+}
+
+// ==========================================
+// PART 9: GROUP SCHEDULING BENCHMARK
+// ==========================================
+
+#define GROUP_DEFAULT_TASKS 20000
+#define GROUP_SHARES        1024    // cpu.shares default
+
+#define HIER_FLAT  0   // no groups
+#define HIER_WIDE  1   // 256 groups side by side under the root
+#define HIER_DEEP  2   // one chain of 16 nested groups, every task in the innermost
+#define HIER_TREE  3   // 4 levels of 4-way fan-out, tasks spread over the 256 leaves
+#define HIER_COUNT 4
+
+static const char *hier_names[HIER_COUNT] = { "flat", "wide", "deep", "tree" };
+
+// Build the hierarchy into groups[] (enough room for 341 groups) and attach
+// the tasks to its leaves. Returns the number of groups used.
+static int build_hierarchy(int kind, task_group *groups, process **procs, int tasks,
+                           const rq_ops *engine) {
+    int n = 0, first_leaf = 0;
+    if (kind == HIER_WIDE) {
+        for (; n < 256; n++) init_task_group(&groups[n], n, NULL, GROUP_SHARES, engine);
+    } else if (kind == HIER_DEEP) {
+        for (; n < 16; n++)
+            init_task_group(&groups[n], n, n ? &groups[n - 1] : NULL, GROUP_SHARES, engine);
+        first_leaf = 15;
+    } else if (kind == HIER_TREE) {
+        // Breadth-first: group g's children are 4g+1..4g+4
+        for (; n < 1 + 4 + 16 + 64 + 256; n++)
+            init_task_group(&groups[n], n, n ? &groups[(n - 1) / 4] : NULL, GROUP_SHARES, engine);
+        first_leaf = 1 + 4 + 16 + 64;
+    }
+    if (n > 0)
+        for (int i = 0; i < tasks; i++)
+            attach_task_group(procs[i], &groups[first_leaf + i % (n - first_leaf)]);
+    return n;
+}
+
+static void destroy_groups(task_group *groups, int n) {
+    for (int i = 0; i < n; i++) cfs_rq_destroy(&groups[i].my_q);
+}
+
+// Two tenants with equal shares: A runs 1000 short tasks, B runs 10 long
+// ones. Without groups B gets ~1% of the CPU until A is done.
+static void run_tenant_demo(const sim_options *opt) {
+    enum { A_TASKS = 1000, B_TASKS = 10 };
+    process *procs[A_TASKS + B_TASKS];
+
+    printf("\nTenants: A = %d tasks x 100 ticks, B = %d tasks x 1000 ticks, equal shares\n",
+           A_TASKS, B_TASKS);
+    printf("Layout\t\tA done (tick)\tB done (tick)\n");
+    for (int grouped = 0; grouped <= 1; grouped++) {
+        process_pool pool = {NULL};
+        task_group tenants[2];
+        for (int i = 0; i < A_TASKS + B_TASKS; i++)
+            procs[i] = create_process(&pool, i, 0, 0, i < A_TASKS ? 100 : 1000);
+        if (grouped) {
+            for (int t = 0; t < 2; t++) init_task_group(&tenants[t], t, NULL, GROUP_SHARES, &rq_engines[0]);
+            for (int i = 0; i < A_TASKS + B_TASKS; i++)
+                attach_task_group(procs[i], &tenants[i < A_TASKS ? 0 : 1]);
+        }
+
+        cfs_rq cfs;
+        cfs_rq_init(&cfs, &rq_engines[0]);
+        sim_stats st;
+        run_cfs(&cfs, procs, A_TASKS + B_TASKS, opt, &st);
+
+        long done[2] = {0, 0};
+        for (int i = 0; i < A_TASKS + B_TASKS; i++) {
+            int t = i < A_TASKS ? 0 : 1;
+            if (procs[i]->finish_tick > done[t]) done[t] = procs[i]->finish_tick;
+        }
+        printf("%s\t%ld\t\t%ld\n", grouped ? "2 groups" : "flat    ", done[0], done[1]);
+
+        cfs_rq_destroy(&cfs);
+        if (grouped) destroy_groups(tenants, 2);
+        pool_destroy(&pool);
+    }
+}
+
+// Usage: ./cfs --bench-groups [tasks]
+// Runs the same task set flat, under a wide hierarchy, a deep one and a
+// balanced tree, and reports the cost per pick; then the tenant demo.
+int run_group_benchmark(int argc, char *argv[], const rq_ops *engine) {
+    int tasks = (argc > 2) ? (int)strtol(argv[2], NULL, 10) : GROUP_DEFAULT_TASKS;
+    if (tasks <= 0) {
+        printf("Usage: %s --bench-groups [tasks]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    process **procs = (process**)malloc(tasks * sizeof(process*));
+    task_group *groups = (task_group*)calloc(341, sizeof(task_group));
+    sim_options opt = {1, NULL, SCHED_LATENCY_NS, SCHED_MIN_GRANULARITY_NS, SCHED_WAKEUP_GRANULARITY_NS, NULL};
+
+    printf("Group scheduling benchmark: %d tasks, %s engine, event-driven, default slices\n",
+           tasks, engine->name);
+    printf("Hierarchy\tGroups\tDepth\tPicks\t\tQueue ops/pick\tTime(s)\tns/pick\tDigest\n");
+    for (int kind = 0; kind < HIER_COUNT; kind++) {
+        process_pool pool = {NULL};
+        fill_random_workload(&pool, procs, tasks, SHAPE_MIXED);
+        int n = build_hierarchy(kind, groups, procs, tasks, engine);
+
+        cfs_rq cfs;
+        cfs_rq_init(&cfs, engine);
+        sim_stats st;
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        run_cfs(&cfs, procs, tasks, &opt, &st);
+        double seconds = elapsed_seconds(&start);
+
+        printf("%s\t\t%d\t%d\t%ld\t\t%.2f\t\t%.3f\t%.1f\t%016llx\n", hier_names[kind], n,
+               procs[0]->se.depth, st.picks, (double)st.tree_ops / st.picks, seconds,
+               seconds * 1e9 / st.picks, (unsigned long long)task_digest(procs, tasks));
+
+        cfs_rq_destroy(&cfs);
+        destroy_groups(groups, n);
+        pool_destroy(&pool);
+    }
+
+    run_tenant_demo(&opt);
+    free(groups);
+    free(procs);
+    return EXIT_SUCCESS;
+}
+
+// ==========================================
+// PART 10: COMMAND LINE
+// ==========================================
+
+// --engine NAME may appear anywhere; it is removed from argv before the
+// mode-specific parsing below
+static const rq_ops* take_engine_option(int *argc, char *argv[]) {
+    const rq_ops *engine = &rq_engines[0];
+    int out = 1;
+    for (int i = 1; i < *argc; i++) {
+        if (strcmp(argv[i], "--engine") == 0 && i + 1 < *argc) {
+            engine = find_rq_engine(argv[++i]);
+            if (engine == NULL) {
+                printf("Unknown engine '%s'. Available:", argv[i]);
+                for (int e = 0; e < RQ_ENGINE_COUNT; e++) printf(" %s", rq_engines[e].name);
+                printf("\n");
+                exit(EXIT_FAILURE);
+            }
+        } else {
+            argv[out++] = argv[i];
+        }
+    }
+    *argc = out;
+    argv[out] = NULL;
+    return engine;
+}
+
+void print_usage(const char *prog) {
+    printf("Usage: %s [--event] [--tasks N [--workload SHAPE]] [--engine NAME]\n", prog);
+    printf("          [--latency MS] [--min-gran MS] [--wakeup-gran MS]   (--latency 0: one-tick picks)\n");
+    printf("          [--trace FILE]   (binary event trace; read it with cfs_trace_decode)\n");
+    printf("          [--timeline FILE | --timeline-csv FILE]   (Gantt timeline; query it with timeline_query)\n");
+    printf("       %s --stress [cycles] [tasks] [--engine NAME]\n", prog);
+    printf("       %s --smp [cpus] [tasks] [--engine NAME]\n", prog);
+    printf("       %s --bench-engines [tasks]\n", prog);
+    printf("       %s --sweep-slices [tasks] [workload]\n", prog);
+    printf("       %s --bench-groups [tasks] [--engine NAME]\n", prog);
+    printf("Engines: rbtree (default), pairing, dary, radix\n");
+    printf("Workloads: mixed (default), lockstep, wide-nice, interactive\n");
+}
+
+int main(int argc, char *argv[]){
+    const rq_ops *engine = take_engine_option(&argc, argv);
+
+    if (argc > 1 && strcmp(argv[1], "--stress") == 0)
+        return run_stress_test(argc, argv, engine);
+    if (argc > 1 && strcmp(argv[1], "--smp") == 0)
+        return run_smp_simulation(argc, argv, engine);
+    if (argc > 1 && strcmp(argv[1], "--bench-engines") == 0)
+        return run_engine_benchmark(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--sweep-slices") == 0)
+        return run_slice_sweep(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--bench-groups") == 0)
+        return run_group_benchmark(argc, argv, engine);
+
+    sim_options opt = {0, NULL, SCHED_LATENCY_NS, SCHED_MIN_GRANULARITY_NS, SCHED_WAKEUP_GRANULARITY_NS, NULL};
+    int tasks = 0;
+    int shape = SHAPE_MIXED;
+    const char *trace_path = NULL;
+    const char *timeline_path = NULL;
+    int timeline_csv = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--event") == 0) {
+            opt.fast_forward = 1;
+        } else if (strcmp(argv[i], "--tasks") == 0 && i + 1 < argc) {
+            tasks = (int)strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--workload") == 0 && i + 1 < argc && find_shape(argv[i + 1]) >= 0) {
+            shape = find_shape(argv[++i]);
+        } else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+            opt.sched_latency_ns = (uint64_t)(strtod(argv[++i], NULL) * 1e6);
+        } else if (strcmp(argv[i], "--min-gran") == 0 && i + 1 < argc) {
+            opt.min_granularity_ns = (uint64_t)(strtod(argv[++i], NULL) * 1e6);
+        } else if (strcmp(argv[i], "--wakeup-gran") == 0 && i + 1 < argc) {
+            opt.wakeup_granularity_ns = (uint64_t)(strtod(argv[++i], NULL) * 1e6);
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if ((strcmp(argv[i], "--timeline") == 0 || strcmp(argv[i], "--timeline-csv") == 0) &&
+                   i + 1 < argc) {
+            timeline_csv = strcmp(argv[i], "--timeline-csv") == 0;
+            timeline_path = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    process_pool pool = {NULL};
+    process *demo[PROCESS_COUNT];
+    process **processes = demo;
+    int verbose = (tasks == 0);
+    if (verbose) {
+        tasks = PROCESS_COUNT;
+        fill_process_array(&pool, processes);
+    } else {
+        // Benchmark run: generated workload, summary only
+        processes = (process**)malloc(tasks * sizeof(process*));
+        fill_random_workload(&pool, processes, tasks, shape);
+    }
+
+    // The demo prints its events; --trace writes them to a file instead,
+    // and --timeline writes only the runs
+    trace_ring trace;
+    if (trace_path != NULL) {
+        trace_ring_open_file(&trace, trace_path);
+        opt.trace = &trace;
+    } else if (verbose && timeline_path == NULL) {
+        trace_ring_open_text(&trace);
+        opt.trace = &trace;
+    }
+    timeline_writer timeline;
+    if (timeline_path != NULL) {
+        timeline_open(&timeline, timeline_path, timeline_csv);
+        opt.timeline = &timeline;
+    }
+
+    cfs_rq cfs;
+    cfs_rq_init(&cfs, engine);
+
+    sim_stats st;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    run_cfs(&cfs, processes, tasks, &opt, &st);
+    double seconds = elapsed_seconds(&start);
+    if (opt.trace) trace_ring_close(opt.trace);
+    uint64_t timeline_records = opt.timeline ? timeline_close(opt.timeline) : 0;
 
     printf("\nAll tasks completed.\n");
+    if (!verbose) {
+        printf("Mode: %s, engine: %s, workload: %s\n", opt.fast_forward ? "event-driven" : "per-tick",
+               engine->name, shape_names[shape]);
+        if (opt.sched_latency_ns == 0) printf("Slices: one tick (legacy)\n");
+        else printf("Slices: latency %.2f ms, min granularity %.2f ms, wakeup granularity %.2f ms\n",
+                    opt.sched_latency_ns / 1e6, opt.min_granularity_ns / 1e6,
+                    opt.wakeup_granularity_ns / 1e6);
+        printf("Tasks: %d, ticks: %ld (%ld idle), picks: %ld\n",
+               tasks, st.ticks, st.idle_ticks, st.picks);
+        printf("Context switches: %ld (%.1f per simulated second)\n", st.context_switches,
+               st.context_switches / (st.ticks * (double)TICK_NS / 1e9));
+        printf("Wakeups: %ld (including arrivals), sleeps: %ld, wakeup preemptions: %ld\n",
+               st.wakeups, st.sleeps, st.wakeup_preemptions);
+        printf("Tree operations: %ld (%.3f per tick)\n", st.tree_ops, (double)st.tree_ops / st.ticks);
+        printf("Task digest: %016llx\n", (unsigned long long)task_digest(processes, tasks));
+        printf("Simulation time: %.3f s\n", seconds);
+    }
+    if (trace_path != NULL) printf("Trace written to %s\n", trace_path);
+    if (timeline_path != NULL)
+        printf("Timeline: %llu records written to %s\n", (unsigned long long)timeline_records,
+               timeline_path);
+    printf("\n");
+    sim_stats_latency_report(&st);
+
+    if (processes != demo) free(processes);
+    cfs_rq_destroy(&cfs);
+    pool_destroy(&pool);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,115 @@
+#ifndef CFS_TRACE_H
+#define CFS_TRACE_H
+
+// Binary event trace shared by cfs.c (writer) and cfs_trace_decode.c (reader).
+//
+// A trace file is a cfs_trace_header followed by fixed-size records in the
+// order the events happened. Records are written in the host's byte order;
+// the header's record_size and magic catch a mismatched reader.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define CFS_TRACE_MAGIC   "CFSTRACE"
+#define CFS_TRACE_VERSION 1
+
+// Event types
+#define CFS_TRACE_TASK   1   // task declared; old_vruntime = weight, new_vruntime = vruntime per tick
+#define CFS_TRACE_ARRIVE 2   // first enqueue; new_vruntime = placed vruntime
+#define CFS_TRACE_WAKE   3   // wakeup from sleep; new_vruntime = placed vruntime
+#define CFS_TRACE_RUN    4   // ran from tick; the tick count is (new - old) / vruntime per tick
+#define CFS_TRACE_BLOCK  5   // blocked on I/O; tick = wakeup tick
+#define CFS_TRACE_EXIT   6   // finished at tick
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+} cfs_trace_header;
+
+typedef struct {
+    uint64_t tick;
+    uint64_t old_vruntime;
+    uint64_t new_vruntime;
+    int32_t pid;
+    uint32_t type;
+} cfs_trace_record;
+
+// Weight and vruntime per tick of every declared task, indexed by pid, so a
+// RUN record can be printed with its weight and tick range
+typedef struct {
+    uint64_t *weight;
+    uint64_t *delta;
+    long size;
+} cfs_trace_tasks;
+
+static void cfs_trace_tasks_free(cfs_trace_tasks *t) {
+    free(t->weight);
+    free(t->delta);
+    memset(t, 0, sizeof(*t));
+}
+
+static void cfs_trace_declare(cfs_trace_tasks *t, int32_t pid, uint64_t weight, uint64_t delta) {
+    if (pid < 0) return;
+    if (pid >= t->size) {
+        long size = t->size ? t->size : 64;
+        while (size <= pid) size *= 2;
+        t->weight = (uint64_t*)realloc(t->weight, size * sizeof(uint64_t));
+        t->delta = (uint64_t*)realloc(t->delta, size * sizeof(uint64_t));
+        if (t->weight == NULL || t->delta == NULL) {
+            printf("Out of memory for the trace task table\n");
+            exit(EXIT_FAILURE);
+        }
+        memset(t->weight + t->size, 0, (size - t->size) * sizeof(uint64_t));
+        memset(t->delta + t->size, 0, (size - t->size) * sizeof(uint64_t));
+        t->size = size;
+    }
+    t->weight[pid] = weight;
+    t->delta[pid] = delta;
+}
+
+// Print one record in the text format of the simulator's demo run
+static void cfs_trace_print(FILE *out, const cfs_trace_record *r, cfs_trace_tasks *t) {
+    uint64_t weight = 0, delta = 0;
+    if (r->pid >= 0 && r->pid < t->size) {
+        weight = t->weight[r->pid];
+        delta = t->delta[r->pid];
+    }
+
+    switch (r->type) {
+    case CFS_TRACE_TASK:
+        cfs_trace_declare(t, r->pid, r->old_vruntime, r->new_vruntime);
+        break;
+    case CFS_TRACE_ARRIVE:
+    case CFS_TRACE_WAKE:
+        fprintf(out, "\n--- Tick %llu: Process %d %s (Vruntime: %llu) ---\n",
+                (unsigned long long)r->tick, r->pid,
+                r->type == CFS_TRACE_ARRIVE ? "arrives" : "wakes up",
+                (unsigned long long)r->new_vruntime);
+        break;
+    case CFS_TRACE_RUN: {
+        uint64_t ticks = delta ? (r->new_vruntime - r->old_vruntime) / delta : 1;
+        if (ticks <= 1) fprintf(out, "\n--- Tick %llu ---\n", (unsigned long long)r->tick);
+        else fprintf(out, "\n--- Ticks %llu-%llu ---\n", (unsigned long long)r->tick,
+                     (unsigned long long)(r->tick + ticks - 1));
+        fprintf(out, "Running Process %d (Weight: %llu, Vruntime: %llu)\n", r->pid,
+                (unsigned long long)weight, (unsigned long long)r->old_vruntime);
+        fprintf(out, "  -> New Vruntime: %llu\n", (unsigned long long)r->new_vruntime);
+        break;
+    }
+    case CFS_TRACE_BLOCK:
+        fprintf(out, "  -> Process %d blocks until tick %llu\n", r->pid, (unsigned long long)r->tick);
+        break;
+    case CFS_TRACE_EXIT:
+        fprintf(out, "  -> Process %d Finished.\n", r->pid);
+        break;
+    default:
+        fprintf(out, "  ?? unknown event %u for process %d at tick %llu\n", r->type, r->pid,
+                (unsigned long long)r->tick);
+        break;
+    }
+}
+
+#endif
@@ -0,0 +1,61 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "cfs_trace.h"
+
+// Turns a binary trace written by `./cfs --trace FILE` back into the text
+// the demo prints, optionally for one process only.
+//
+// Usage: ./cfs_trace_decode FILE [--pid N]
+
+#define DECODE_BLOCK_RECORDS 16384   // records read per fread
+
+int main(int argc, char *argv[]) {
+    if (argc != 2 && !(argc == 4 && strcmp(argv[2], "--pid") == 0)) {
+        printf("Usage: %s FILE [--pid N]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    int only_pid = -1;
+    if (argc == 4) only_pid = (int)strtol(argv[3], NULL, 10);
+
+    FILE *in = fopen(argv[1], "rb");
+    if (in == NULL) {
+        printf("Cannot open trace file '%s'\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    cfs_trace_header header;
+    if (fread(&header, sizeof(header), 1, in) != 1 ||
+        memcmp(header.magic, CFS_TRACE_MAGIC, sizeof(header.magic)) != 0) {
+        printf("'%s' is not a CFS trace file\n", argv[1]);
+        fclose(in);
+        return EXIT_FAILURE;
+    }
+    if (header.version != CFS_TRACE_VERSION || header.record_size != sizeof(cfs_trace_record)) {
+        printf("Unsupported trace version %u (record size %u)\n", header.version, header.record_size);
+        fclose(in);
+        return EXIT_FAILURE;
+    }
+
+    cfs_trace_record *block = (cfs_trace_record*)malloc(DECODE_BLOCK_RECORDS * sizeof(cfs_trace_record));
+    cfs_trace_tasks tasks = {NULL, NULL, 0};
+    long events = 0;
+    size_t n;
+    while ((n = fread(block, sizeof(cfs_trace_record), DECODE_BLOCK_RECORDS, in)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            // Task declarations are always read, so every run has its weight
+            if (only_pid >= 0 && block[i].pid != only_pid && block[i].type != CFS_TRACE_TASK)
+                continue;
+            cfs_trace_print(stdout, &block[i], &tasks);
+            if (block[i].type != CFS_TRACE_TASK) events++;
+        }
+    }
+    if (ferror(in)) printf("Error reading '%s'\n", argv[1]);
+
+    printf("\n%ld events decoded.\n", events);
+    cfs_trace_tasks_free(&tasks);
+    free(block);
+    fclose(in);
+    return EXIT_SUCCESS;
+}
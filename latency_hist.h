@@ -0,0 +1,98 @@
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+// Log-bucketed latency histogram in the style of HdrHistogram, shared by
+// the schedulers for waiting, turnaround and response time percentiles.
+// Every power of two is split into LATENCY_HIST_SUB linear sub-buckets, so
+// values below 2 * LATENCY_HIST_SUB are counted exactly and larger ones to
+// within 1 / LATENCY_HIST_SUB (under 1%). Recording is a count-leading-zeros,
+// a shift and an increment: O(1), and nothing is allocated, so it can sit
+// in a scheduler's inner loop. The footprint is fixed (about 59 KB) however
+// many values go in, and a zeroed histogram is a valid empty one.
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#define LATENCY_HIST_SUB_BITS 7
+#define LATENCY_HIST_SUB (1 << LATENCY_HIST_SUB_BITS)
+#define LATENCY_HIST_BUCKETS ((64 - LATENCY_HIST_SUB_BITS + 1) * LATENCY_HIST_SUB)
+
+typedef struct {
+    uint64_t counts[LATENCY_HIST_BUCKETS];
+    uint64_t total;
+    long long min;
+    long long max;
+    long long sum;          // for the mean
+} latency_hist;
+
+static inline void latency_hist_reset(latency_hist *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+// Bucket of a value: exact below 2 * SUB, then SUB buckets per power of two
+static inline int latency_hist_bucket(uint64_t v) {
+    if (v < LATENCY_HIST_SUB) return (int)v;
+    int shift = 63 - __builtin_clzll(v) - LATENCY_HIST_SUB_BITS;
+    return (shift + 1) * LATENCY_HIST_SUB + (int)((v >> shift) - LATENCY_HIST_SUB);
+}
+
+// Largest value that falls in bucket b
+static inline long long latency_hist_bucket_top(int b) {
+    if (b < 2 * LATENCY_HIST_SUB) return b;
+    int shift = b / LATENCY_HIST_SUB - 1;
+    uint64_t low = (uint64_t)(b % LATENCY_HIST_SUB + LATENCY_HIST_SUB) << shift;
+    return (long long)(low + (((uint64_t)1 << shift) - 1));
+}
+
+// Negative values (which no schedule should produce) count as 0
+static inline void latency_hist_record(latency_hist *h, long long value) {
+    if (value < 0) value = 0;
+    h->counts[latency_hist_bucket((uint64_t)value)]++;
+    if (h->total == 0 || value < h->min) h->min = value;
+    if (value > h->max) h->max = value;
+    h->total++;
+    h->sum += value;
+}
+
+static inline double latency_hist_mean(const latency_hist *h) {
+    return h->total > 0 ? (double)h->sum / h->total : 0.0;
+}
+
+// The q-quantile (0 <= q <= 1): the value of rank (long)(total * q) in
+// sorted order (the last one for q = 1), as the top of its bucket, clamped
+// to the recorded min and max. Exact for values below 2 * SUB.
+static inline long long latency_hist_percentile(const latency_hist *h, double q) {
+    if (h->total == 0) return 0;
+    uint64_t rank = (uint64_t)(h->total * q);
+    if (rank >= h->total) rank = h->total - 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < LATENCY_HIST_BUCKETS; b++) {
+        seen += h->counts[b];
+        if (seen > rank) {
+            long long v = latency_hist_bucket_top(b);
+            if (v > h->max) v = h->max;
+            if (v < h->min) v = h->min;
+            return v;
+        }
+    }
+    return h->max;
+}
+
+static inline void latency_hist_print_header(const char *title) {
+    printf("%-20s %10s %10s %10s %10s %10s %10s %10s\n", title, "Samples", "Mean", "p50", "p90",
+           "p99", "p99.9", "Max");
+}
+
+static inline void latency_hist_print(const char *label, const latency_hist *h) {
+    if (h->total == 0) {
+        printf("%-20s %10d %10s %10s %10s %10s %10s %10s\n", label, 0, "-", "-", "-", "-", "-", "-");
+        return;
+    }
+    printf("%-20s %10llu %10.2f %10lld %10lld %10lld %10lld %10lld\n", label,
+           (unsigned long long)h->total, latency_hist_mean(h), latency_hist_percentile(h, 0.50),
+           latency_hist_percentile(h, 0.90), latency_hist_percentile(h, 0.99),
+           latency_hist_percentile(h, 0.999), h->max);
+}
+
+#endif
@@ -1,383 +1,1539 @@
-/* ============================================================
-   Banker's Algorithm Implementation - SAFE INITIAL STATE VERSION
-   ============================================================ */
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <pthread.h>
-#include <unistd.h>
-#include <time.h>
-
-#define NUMBER_OF_RESOURCES 5
-#define NUMBER_OF_CUSTOMERS 5
-
-int available[NUMBER_OF_RESOURCES];
-int maximum[NUMBER_OF_CUSTOMERS][NUMBER_OF_RESOURCES];
-int allocation[NUMBER_OF_CUSTOMERS][NUMBER_OF_RESOURCES];
-int need[NUMBER_OF_CUSTOMERS][NUMBER_OF_RESOURCES];
-
-pthread_mutex_t mutex_lock;
-int running = 1;
-
-/* ============================================================
-   SAFE MAXIMUM MATRIX CONFIGURATION
-   With available = [10, 5, 7, 3, 2], this ensures safe state
-   ============================================================ */
-void initialize_system(int argc, char *argv[]) {
-    if (argc < NUMBER_OF_RESOURCES + 1) {
-        printf("Error: Not enough arguments. Provide %d resource values.\n", NUMBER_OF_RESOURCES);
-        printf("Usage: %s", argv[0]);
-        for (int i = 0; i < NUMBER_OF_RESOURCES; i++) {
-            printf(" r%d", i + 1);
-        }
-        printf("\n");
-        exit(EXIT_FAILURE);
-    }
-    
-    for (int i = 0; i < NUMBER_OF_RESOURCES; i++) {
-        available[i] = strtol(argv[i + 1], NULL, 10);
-        printf("Resource R%d available: %d\n", i + 1, available[i]);
-    }
-    
-    /* SAFE CONFIGURATION: Total needs <= Total resources */
-    /* Total resources: [10, 5, 7, 3, 2] */
-    /* SAFE maximum matrix: */
-    /* CORRECTED SAFE MAXIMUM MATRIX */
-    int max_matrix[NUMBER_OF_CUSTOMERS][NUMBER_OF_RESOURCES] = {
-        /* Customer 0: Reduced R1 from 3 to 2 */
-        {2, 2, 1, 1, 1},  /* Total: 7 of available 10 */
-    
-        /* Customer 1: Reduced R1 from 2 to 1 */
-        {1, 1, 2, 1, 1},  /* Total: 6 of available 10 */
-    
-        /* Customer 2: Keep same */
-        {4, 1, 2, 0, 0},  /* Doesn't need R4 and R5 */
-    
-        /* Customer 3: Keep same */
-        {1, 0, 1, 1, 0},  /* Very small needs */
-    
-        /* Customer 4: Reduced R1 from 2 to 2 (keep same) */
-        {2, 1, 1, 0, 0}   /* Doesn't need all resources */
-    };
-    
-    /* VERIFY: Total maximum demand should be <= total resources */
-    int total_max[NUMBER_OF_RESOURCES] = {0};
-    for (int i = 0; i < NUMBER_OF_CUSTOMERS; i++) {
-        for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-            maximum[i][j] = max_matrix[i][j];
-            total_max[j] += max_matrix[i][j];
-        }
-    }
-    
-    printf("\nTotal maximum demand per resource: ");
-    for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-        printf("R%d: %d/%d  ", j+1, total_max[j], available[j]);
-    }
-    printf("\n");
-    
-    for (int i = 0; i < NUMBER_OF_CUSTOMERS; i++) {
-        for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-            allocation[i][j] = 0;
-        }
-    }
-    
-    for (int i = 0; i < NUMBER_OF_CUSTOMERS; i++) {
-        for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-            need[i][j] = maximum[i][j] - allocation[i][j];
-        }
-    }
-    
-    printf("System initialized successfully!\n");
-}
-
-void print_state() {
-    printf("\n=== CURRENT SYSTEM STATE ===\n");
-    
-    printf("Available resources: ");
-    for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-        printf("R%d: %d  ", j + 1, available[j]);
-    }
-    printf("\n\n");
-    
-    printf("Customer\tMax\t\tAllocation\tNeed\n");
-    printf("--------\t---\t\t----------\t----\n");
-    
-    for (int i = 0; i < NUMBER_OF_CUSTOMERS; i++) {
-        printf("C%d\t\t", i);
-        
-        for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-            printf("%d ", maximum[i][j]);
-        }
-        printf("\t");
-        
-        for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-            printf("%d ", allocation[i][j]);
-        }
-        printf("\t");
-        
-        for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-            printf("%d ", need[i][j]);
-        }
-        printf("\n");
-    }
-    printf("=============================\n\n");
-}
-
-int is_safe() {
-    int work[NUMBER_OF_RESOURCES];
-    int finish[NUMBER_OF_CUSTOMERS];
-    
-    for (int i = 0; i < NUMBER_OF_RESOURCES; i++) {
-        work[i] = available[i];
-    }
-    
-    for (int i = 0; i < NUMBER_OF_CUSTOMERS; i++) {
-        finish[i] = 0;
-    }
-    
-    int found;
-    for (int count = 0; count < NUMBER_OF_CUSTOMERS; count++) {
-        found = 0;
-        
-        for (int i = 0; i < NUMBER_OF_CUSTOMERS; i++) {
-            if (finish[i] == 0) {
-                int can_allocate = 1;
-                
-                for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-                    if (need[i][j] > work[j]) {
-                        can_allocate = 0;
-                        break;
-                    }
-                }
-                
-                if (can_allocate) {
-                    for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-                        work[j] += allocation[i][j];
-                    }
-                    
-                    finish[i] = 1;
-                    found = 1;
-                    break;
-                }
-            }
-        }
-        
-        if (!found) {
-            return 0;
-        }
-    }
-    
-    return 1;
-}
-
-int request_resources(int customer_num, int request[]) {
-    printf("\nCustomer %d requesting: ", customer_num);
-    for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-        if (request[j] > 0) printf("R%d:%d ", j + 1, request[j]);
-    }
-    printf("\n");
-    
-    for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-        if (request[j] > need[customer_num][j]) {
-            printf("  ERROR: Request exceeds need\n");
-            return -1;
-        }
-    }
-    
-    for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-        if (request[j] > available[j]) {
-            printf("  Resources not available. Waiting...\n");
-            return -1;
-        }
-    }
-    
-    for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-        available[j] -= request[j];
-        allocation[customer_num][j] += request[j];
-        need[customer_num][j] -= request[j];
-    }
-    
-    if (is_safe()) {
-        printf("  Request GRANTED to Customer %d\n", customer_num);
-        return 0;
-    } else {
-        printf("  Request DENIED to Customer %d (unsafe)\n", customer_num);
-        
-        for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-            available[j] += request[j];
-            allocation[customer_num][j] -= request[j];
-            need[customer_num][j] += request[j];
-        }
-        
-        return -1;
-    }
-}
-
-int release_resources(int customer_num, int release[]) {
-    printf("\nCustomer %d releasing: ", customer_num);
-    for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-        if (release[j] > 0) printf("R%d:%d ", j + 1, release[j]);
-    }
-    printf("\n");
-    
-    for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-        if (release[j] > allocation[customer_num][j]) {
-            printf("  ERROR: Cannot release more than allocated\n");
-            return -1;
-        }
-    }
-    
-    for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-        available[j] += release[j];
-        allocation[customer_num][j] -= release[j];
-        need[customer_num][j] = maximum[customer_num][j] - allocation[customer_num][j];
-    }
-    
-    printf("  Resources released successfully\n");
-    return 0;
-}
-
-void* customer_thread(void* arg) {
-    int customer_id = *(int*)arg;
-    unsigned int seed = time(NULL) + customer_id;
-    
-    printf("Customer %d started\n", customer_id);
-    
-    while (running) {
-        /* Generate SMART requests that are more likely to succeed */
-        int request[NUMBER_OF_RESOURCES] = {0};
-        
-        /* Strategy: Request small amounts, not everything at once */
-        for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-            if (need[customer_id][j] > 0) {
-                /* Request 0-50% of remaining need, but max 2 of any resource */
-                int max_request = need[customer_id][j];
-                if (max_request > 2) max_request = 2;
-                request[j] = rand_r(&seed) % (max_request + 1);
-            }
-        }
-        
-        /* Don't make empty requests */
-        int all_zero = 1;
-        for (int j = 0; j < NUMBER_OF_RESOURCES; j++) {
-            if (request[j] > 0) {
-                all_zero = 0;
-                break;
-            }
-        }
-        if (all_zero) {
-            usleep(200000);
-            continue;
-        }
-        
-        pthread_mutex_lock(&mutex_lock);
-        int result = request_resources(customer_id, request);
-        pthread_mutex_unlock(&mutex_lock);
-        
-        if (result == 0) {
-            printf("Customer %d using resources...\n", customer_id);
-            
-            /* Use resources for 1-4 seconds */
-            int use_time = 1 + (rand_r(&seed) % 4);
-            sleep(use_time);
-            
-            pthread_mutex_lock(&mutex_lock);
-            release_resources(customer_id, request);
-            pthread_mutex_unlock(&mutex_lock);
-            
-            printf("Customer %d finished using resources\n", customer_id);
-        } else {
-            printf("Customer %d request denied\n", customer_id);
-        }
-        
-        /* Wait 1-3 seconds before next request */
-        int delay = 1 + (rand_r(&seed) % 3);
-        sleep(delay);
-    }
-    
-    printf("Customer %d exiting\n", customer_id);
-    return NULL;
-}
-
-int main(int argc, char *argv[]) {
-    printf("\n============ BANKER'S ALGORITHM SIMULATION ============\n");
-    
-    /* Use default values if no arguments provided */
-    if (argc == 1) {
-        printf("Using default resource values: 10 5 7 3 2\n");
-        char* default_args[] = {"./banker", "10", "5", "7", "3", "2", NULL};
-        initialize_system(6, default_args);
-    } else {
-        initialize_system(argc, argv);
-    }
-    
-    if (pthread_mutex_init(&mutex_lock, NULL) != 0) {
-        printf("Mutex initialization failed\n");
-        return EXIT_FAILURE;
-    }
-    
-    print_state();
-    
-    printf("\nChecking initial system safety...\n");
-    pthread_mutex_lock(&mutex_lock);
-    int initial_safe = is_safe();
-    pthread_mutex_unlock(&mutex_lock);
-    
-    if (!initial_safe) {
-        printf("ERROR: Initial system state is unsafe!\n");
-        return EXIT_FAILURE;
-    }
-    
-    printf("Initial state is SAFE ✓\n");
-    
-    pthread_t customers[NUMBER_OF_CUSTOMERS];
-    int customer_ids[NUMBER_OF_CUSTOMERS];
-    
-    printf("\nCreating %d customer threads...\n", NUMBER_OF_CUSTOMERS);
-    
-    for (int i = 0; i < NUMBER_OF_CUSTOMERS; i++) {
-        customer_ids[i] = i;
-        if (pthread_create(&customers[i], NULL, customer_thread, &customer_ids[i]) != 0) {
-            printf("Failed to create thread for customer %d\n", i);
-            return EXIT_FAILURE;
-        }
-    }
-    
-    printf("\n=== SIMULATION STARTED ===\n");
-    printf("Running for 30 seconds...\n\n");
-    
-    /* Run simulation */
-    for (int t = 0; t < 30; t++) {
-        printf("[Time: %02d sec] ", t);
-        fflush(stdout);
-        sleep(1);
-    }
-    
-    printf("\n\n=== STOPPING SIMULATION ===\n");
-    running = 0;
-    
-    /* Wait for threads */
-    for (int i = 0; i < NUMBER_OF_CUSTOMERS; i++) {
-        pthread_join(customers[i], NULL);
-        printf("Customer %d joined\n", i);
-    }
-    
-    pthread_mutex_destroy(&mutex_lock);
-    
-    printf("\n=== FINAL STATE ===\n");
-    print_state();
-    
-    pthread_mutex_lock(&mutex_lock);
-    printf("Final safety check: ");
-    int final_safe = is_safe();
-    pthread_mutex_unlock(&mutex_lock);
-    
-    if (final_safe) {
-        printf("SAFE ✓\n\nSUCCESS: Simulation completed without deadlock!\n");
-    } else {
-        printf("UNSAFE ✗\n\nWARNING: Simulation ended in unsafe state!\n");
-    }
-    
-    printf("\n============ SIMULATION COMPLETE ============\n");
-    return EXIT_SUCCESS;
-}
\ No newline at end of file
+/* ============================================================
+   Banker's Algorithm Implementation - SAFE INITIAL STATE VERSION
+   ============================================================ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <time.h>
+#include "latency_hist.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/* Usage: ./banker                       built-in 5 x 5 system
+          ./banker r1 r2 r3 r4 r5        built-in system, given resources
+          ./banker --config FILE         any number of customers and resources
+          ./banker --bench               time is_safe() at 1k-10k customers
+          ./banker --bench-kernels       time the vector kernels
+          ./banker --bench-admission     mutex against batched admission
+   Options: --threads N (customer threads, default one per customer up
+            to MAX_DEFAULT_THREADS), --seconds S (default 30), --quiet (no
+            per-request log, counters only), --kernel scalar|sse4|avx2
+            (default: the best the CPU supports), --combine (admit
+            requests in batches, see BATCHED ADMISSION)
+
+   A config file holds whitespace-separated keywords and numbers, with
+   '#' comments to the end of the line:
+
+       resources 3
+       customers 2
+       available 10 5 7
+       maximum 7 5 3      # customer 0
+       maximum 3 2 2      # customer 1
+
+   with one "maximum" row per customer, in order. */
+
+#define DEFAULT_RESOURCES 5
+#define DEFAULT_CUSTOMERS 5
+#define DEFAULT_SECONDS 30
+#define MAX_DEFAULT_THREADS 64
+#define PRINT_STATE_CUSTOMERS 20    /* rows print_state shows */
+#define CACHE_LINE 64
+#define INTS_PER_LINE (CACHE_LINE / (int)sizeof(int))
+
+int number_of_resources;
+int number_of_customers;
+
+/* ============================================================
+   STATE ARENA
+   Every vector and matrix lives in one cache-line-aligned block.
+   Matrix rows are padded to a whole number of cache lines
+   (row_stride ints), so customer i's row starts on its own line
+   and the padding is zero. work and finish are the safety
+   checks' scratch space, so no call allocates.
+
+   For is_safe() every resource j also keeps the customers sorted
+   by need[i][j]: need_key holds the sorted needs and need_order
+   the customers, and need_rank[i][j] is customer i's place in
+   resource j's order. reposition_need() keeps them sorted as a
+   customer's need changes. The last safe sequence that
+   is_safe() found is cached too (see INCREMENTAL SAFETY).
+   ============================================================ */
+int row_stride;
+int *arena;
+int *available;     /* [row_stride] */
+int *work;          /* [row_stride] */
+int *maximum;       /* [number_of_customers][row_stride] */
+int *allocation;
+int *need;
+int *finish;        /* [number_of_customers] */
+int order_stride;   /* number_of_customers, padded to a cache line */
+int *need_key;      /* [number_of_resources][order_stride] */
+int *need_order;
+int *need_rank;     /* [number_of_customers][row_stride] */
+int *cursor;        /* is_safe() scratch: [row_stride] */
+int *pending;       /* is_safe_after_batch() scratch: [row_stride] */
+int *blocked;       /* [number_of_customers] */
+int *ready;
+int *checked_sequence;  /* is_safe()'s finishing order */
+int *safe_sequence;     /* the cached safe sequence */
+int *sequence_position; /* customer's place in safe_sequence */
+int *prefix_work;       /* [number_of_customers][row_stride] */
+
+pthread_mutex_t mutex_lock;
+volatile int running = 1;
+int verbose = 1;
+
+/* Outcomes of request_resources, under mutex_lock */
+long requests_granted = 0;
+long requests_unsafe = 0;       /* denied: state would be unsafe */
+long requests_unavailable = 0;  /* denied: not enough available */
+long requests_invalid = 0;      /* denied: more than the need */
+
+static inline int *row(int *matrix, int customer) {
+    return matrix + (size_t)customer * row_stride;
+}
+
+void allocate_state(int customers, int resources) {
+    if (customers <= 0 || resources <= 0) {
+        printf("Error: Need at least one customer and one resource type.\n");
+        exit(EXIT_FAILURE);
+    }
+    number_of_customers = customers;
+    number_of_resources = resources;
+    row_stride = (resources + INTS_PER_LINE - 1) / INTS_PER_LINE * INTS_PER_LINE;
+
+    size_t vector = (size_t)row_stride;
+    size_t matrix = (size_t)customers * row_stride;
+    order_stride = (customers + INTS_PER_LINE - 1) / INTS_PER_LINE * INTS_PER_LINE;
+    size_t flags = (size_t)order_stride;
+    size_t orders = (size_t)resources * order_stride;
+    size_t bytes = (4 * vector + 5 * matrix + 6 * flags + 2 * orders) * sizeof(int);
+
+    arena = aligned_alloc(CACHE_LINE, bytes);
+    if (arena == NULL) {
+        printf("Error: Cannot allocate %zu bytes for %d customers and %d resources.\n",
+               bytes, customers, resources);
+        exit(EXIT_FAILURE);
+    }
+    memset(arena, 0, bytes);
+    available = arena;
+    work = available + vector;
+    maximum = work + vector;
+    allocation = maximum + matrix;
+    need = allocation + matrix;
+    finish = need + matrix;
+    need_key = finish + flags;
+    need_order = need_key + orders;
+    need_rank = need_order + orders;
+    cursor = need_rank + matrix;
+    pending = cursor + vector;
+    blocked = pending + vector;
+    ready = blocked + flags;
+    checked_sequence = ready + flags;
+    safe_sequence = checked_sequence + flags;
+    sequence_position = safe_sequence + flags;
+    prefix_work = sequence_position + flags;
+}
+
+/* Zeroed array of count elements for the state's working buffers; a
+   failed allocation exits like allocate_state does */
+void* allocate_array(size_t count, size_t size, const char *what) {
+    void *array = calloc(count > 0 ? count : 1, size);
+    if (array == NULL) {
+        printf("Error: Cannot allocate %zu bytes for %s.\n", count * size, what);
+        exit(EXIT_FAILURE);
+    }
+    return array;
+}
+
+static inline int *resource_keys(int resource) {
+    return need_key + (size_t)resource * order_stride;
+}
+
+static inline int *resource_order(int resource) {
+    return need_order + (size_t)resource * order_stride;
+}
+
+static int sort_resource;
+
+static int compare_need(const void *a, const void *b) {
+    int x = row(need, *(const int *)a)[sort_resource];
+    int y = row(need, *(const int *)b)[sort_resource];
+    return (x > y) - (x < y);
+}
+
+/* Sort every resource's customers by need from scratch */
+void build_need_order(void) {
+    for (int j = 0; j < number_of_resources; j++) {
+        int *key = resource_keys(j), *order = resource_order(j);
+        for (int i = 0; i < number_of_customers; i++) order[i] = i;
+        sort_resource = j;
+        qsort(order, number_of_customers, sizeof(int), compare_need);
+        for (int k = 0; k < number_of_customers; k++) {
+            key[k] = row(need, order[k])[j];
+            row(need_rank, order[k])[j] = k;
+        }
+    }
+}
+
+/* First place in key[lo, hi) whose key is >= value */
+static int lower_bound(const int *key, int lo, int hi, int value) {
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (key[mid] < value) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* Move a customer whose need row just changed to its new place in every
+   resource's order. Customers with equal needs may sit in any order, so
+   instead of shifting each one it passes, the customer trades places with
+   the far end of each run of equal keys: one move per distinct need
+   value crossed. */
+void reposition_need(int customer) {
+    const int *need_c = row(need, customer);
+    int *rank_c = row(need_rank, customer);
+    int n = number_of_customers;
+
+    for (int j = 0; j < number_of_resources; j++) {
+        int *key = resource_keys(j), *order = resource_order(j);
+        int value = need_c[j], k = rank_c[j];
+        if (key[k] == value) continue;
+
+        /* k is a hole to fill; runs of larger (smaller) keys move past it */
+        while (k > 0 && key[k - 1] > value) {
+            int first = lower_bound(key, 0, k, key[k - 1]);
+            key[k] = key[first];
+            order[k] = order[first];
+            row(need_rank, order[k])[j] = k;
+            k = first;
+        }
+        while (k + 1 < n && key[k + 1] < value) {
+            int last = lower_bound(key, k + 1, n, key[k + 1] + 1) - 1;
+            key[k] = key[last];
+            order[k] = order[last];
+            row(need_rank, order[k])[j] = k;
+            k = last;
+        }
+        key[k] = value;
+        order[k] = customer;
+        rank_c[j] = k;
+    }
+}
+
+/* ============================================================
+   VECTOR KERNELS
+   The resource-vector loops of the safety checks, requests and
+   releases: "all(a <= b)", "a += b" and "a -= b" over n ints.
+   There are AVX2 and SSE4.1 versions, compiled with target
+   attributes so the file needs no -m flags, and select_kernels()
+   points the calls at the best one the CPU runs. fits() tests a
+   whole vector of lanes per compare and stops at the first one
+   that fails. Arena rows are padded with zeros, so over them n
+   can be row_stride and no scalar tail is left; a caller's own
+   request vector is only number_of_resources long.
+   ============================================================ */
+static int fits_scalar(const int *a, const int *b, int n) {
+    for (int j = 0; j < n; j++) {
+        if (a[j] > b[j]) return 0;
+    }
+    return 1;
+}
+
+static void add_scalar(int *a, const int *b, int n) {
+    for (int j = 0; j < n; j++) a[j] += b[j];
+}
+
+static void sub_scalar(int *a, const int *b, int n) {
+    for (int j = 0; j < n; j++) a[j] -= b[j];
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse4.1")))
+static int fits_sse4(const int *a, const int *b, int n) {
+    int j = 0;
+    for (; j + 4 <= n; j += 4) {
+        __m128i over = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *)(a + j)),
+                                       _mm_loadu_si128((const __m128i *)(b + j)));
+        if (!_mm_testz_si128(over, over)) return 0;
+    }
+    return fits_scalar(a + j, b + j, n - j);
+}
+
+__attribute__((target("sse4.1")))
+static void add_sse4(int *a, const int *b, int n) {
+    int j = 0;
+    for (; j + 4 <= n; j += 4) {
+        __m128i sum = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(a + j)),
+                                    _mm_loadu_si128((const __m128i *)(b + j)));
+        _mm_storeu_si128((__m128i *)(a + j), sum);
+    }
+    add_scalar(a + j, b + j, n - j);
+}
+
+__attribute__((target("sse4.1")))
+static void sub_sse4(int *a, const int *b, int n) {
+    int j = 0;
+    for (; j + 4 <= n; j += 4) {
+        __m128i difference = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(a + j)),
+                                           _mm_loadu_si128((const __m128i *)(b + j)));
+        _mm_storeu_si128((__m128i *)(a + j), difference);
+    }
+    sub_scalar(a + j, b + j, n - j);
+}
+
+__attribute__((target("avx2")))
+static int fits_avx2(const int *a, const int *b, int n) {
+    int j = 0;
+    for (; j + 8 <= n; j += 8) {
+        __m256i over = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i *)(a + j)),
+                                          _mm256_loadu_si256((const __m256i *)(b + j)));
+        if (!_mm256_testz_si256(over, over)) return 0;
+    }
+    return fits_scalar(a + j, b + j, n - j);
+}
+
+__attribute__((target("avx2")))
+static void add_avx2(int *a, const int *b, int n) {
+    int j = 0;
+    for (; j + 8 <= n; j += 8) {
+        __m256i sum = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(a + j)),
+                                       _mm256_loadu_si256((const __m256i *)(b + j)));
+        _mm256_storeu_si256((__m256i *)(a + j), sum);
+    }
+    add_scalar(a + j, b + j, n - j);
+}
+
+__attribute__((target("avx2")))
+static void sub_avx2(int *a, const int *b, int n) {
+    int j = 0;
+    for (; j + 8 <= n; j += 8) {
+        __m256i difference = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)(a + j)),
+                                              _mm256_loadu_si256((const __m256i *)(b + j)));
+        _mm256_storeu_si256((__m256i *)(a + j), difference);
+    }
+    sub_scalar(a + j, b + j, n - j);
+}
+#endif
+
+typedef struct {
+    const char *name;
+    int (*fits)(const int *a, const int *b, int n);
+    void (*add)(int *a, const int *b, int n);
+    void (*sub)(int *a, const int *b, int n);
+} vector_kernels;
+
+static const vector_kernels kernel_table[] = {
+    {"scalar", fits_scalar, add_scalar, sub_scalar},
+#if defined(__x86_64__) || defined(__i386__)
+    {"sse4", fits_sse4, add_sse4, sub_sse4},
+    {"avx2", fits_avx2, add_avx2, sub_avx2},
+#endif
+};
+#define KERNEL_COUNT ((int)(sizeof(kernel_table) / sizeof(kernel_table[0])))
+
+vector_kernels kernels = {"scalar", fits_scalar, add_scalar, sub_scalar};
+
+static int kernel_supported(const vector_kernels *k) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (strcmp(k->name, "avx2") == 0) return __builtin_cpu_supports("avx2");
+    if (strcmp(k->name, "sse4") == 0) return __builtin_cpu_supports("sse4.1");
+#endif
+    return strcmp(k->name, "scalar") == 0;
+}
+
+/* Use the named kernels, or with NULL the best supported. Returns 0 if
+   the name is unknown or the CPU cannot run them. */
+int select_kernels(const char *name) {
+    for (int k = KERNEL_COUNT - 1; k >= 0; k--) {
+        if (name != NULL && strcmp(kernel_table[k].name, name) != 0) continue;
+        if (!kernel_supported(&kernel_table[k])) return name == NULL ? select_kernels("scalar") : 0;
+        kernels = kernel_table[k];
+        return 1;
+    }
+    return 0;
+}
+
+/* ============================================================
+   CONFIG FILE
+   ============================================================ */
+static int read_word(FILE *in, char *word, size_t size) {
+    int c;
+    for (;;) {
+        while ((c = fgetc(in)) == ' ' || c == '\t' || c == '\n' || c == '\r') ;
+        if (c != '#') break;
+        while ((c = fgetc(in)) != EOF && c != '\n') ;
+    }
+    if (c == EOF) return 0;
+    size_t n = 0;
+    do {
+        if (n + 1 < size) word[n++] = (char)c;
+    } while ((c = fgetc(in)) != EOF && c != ' ' && c != '\t' && c != '\n' && c != '\r' && c != '#');
+    if (c == '#') ungetc(c, in);
+    word[n] = '\0';
+    return 1;
+}
+
+static void config_error(const char *path, const char *what) {
+    printf("Error: %s: %s\n", path, what);
+    exit(EXIT_FAILURE);
+}
+
+static void expect_keyword(FILE *in, const char *path, const char *keyword) {
+    char word[64];
+    if (!read_word(in, word, sizeof(word)) || strcmp(word, keyword) != 0) {
+        char what[96];
+        snprintf(what, sizeof(what), "expected \"%s\"", keyword);
+        config_error(path, what);
+    }
+}
+
+static int read_count(FILE *in, const char *path) {
+    char word[64], *end;
+    if (!read_word(in, word, sizeof(word))) config_error(path, "unexpected end of file");
+    long v = strtol(word, &end, 10);
+    if (*end != '\0' || v < 0 || v > 1000000000L) config_error(path, "expected a non-negative number");
+    return (int)v;
+}
+
+void load_config(const char *path) {
+    FILE *in = fopen(path, "r");
+    if (in == NULL) {
+        printf("Error: Cannot open config file '%s'\n", path);
+        exit(EXIT_FAILURE);
+    }
+    expect_keyword(in, path, "resources");
+    int resources = read_count(in, path);
+    expect_keyword(in, path, "customers");
+    int customers = read_count(in, path);
+    allocate_state(customers, resources);
+
+    expect_keyword(in, path, "available");
+    for (int j = 0; j < resources; j++) available[j] = read_count(in, path);
+    for (int i = 0; i < customers; i++) {
+        expect_keyword(in, path, "maximum");
+        for (int j = 0; j < resources; j++) row(maximum, i)[j] = read_count(in, path);
+    }
+    char word[64];
+    if (read_word(in, word, sizeof(word))) config_error(path, "more rows than customers");
+    fclose(in);
+}
+
+/* ============================================================
+   SAFE MAXIMUM MATRIX CONFIGURATION
+   With available = [10, 5, 7, 3, 2], this ensures safe state
+   ============================================================ */
+void load_default_system(int argc, char *argv[]) {
+    if (argc < DEFAULT_RESOURCES + 1) {
+        printf("Error: Not enough arguments. Provide %d resource values.\n", DEFAULT_RESOURCES);
+        printf("Usage: %s", argv[0]);
+        for (int i = 0; i < DEFAULT_RESOURCES; i++) {
+            printf(" r%d", i + 1);
+        }
+        printf("\n");
+        exit(EXIT_FAILURE);
+    }
+    allocate_state(DEFAULT_CUSTOMERS, DEFAULT_RESOURCES);
+
+    for (int i = 0; i < DEFAULT_RESOURCES; i++) {
+        available[i] = strtol(argv[i + 1], NULL, 10);
+    }
+
+    /* SAFE CONFIGURATION: Total needs <= Total resources */
+    /* Total resources: [10, 5, 7, 3, 2] */
+    /* SAFE maximum matrix: */
+    /* CORRECTED SAFE MAXIMUM MATRIX */
+    int max_matrix[DEFAULT_CUSTOMERS][DEFAULT_RESOURCES] = {
+        /* Customer 0: Reduced R1 from 3 to 2 */
+        {2, 2, 1, 1, 1},  /* Total: 7 of available 10 */
+
+        /* Customer 1: Reduced R1 from 2 to 1 */
+        {1, 1, 2, 1, 1},  /* Total: 6 of available 10 */
+
+        /* Customer 2: Keep same */
+        {4, 1, 2, 0, 0},  /* Doesn't need R4 and R5 */
+
+        /* Customer 3: Keep same */
+        {1, 0, 1, 1, 0},  /* Very small needs */
+
+        /* Customer 4: Reduced R1 from 2 to 2 (keep same) */
+        {2, 1, 1, 0, 0}   /* Doesn't need all resources */
+    };
+
+    for (int i = 0; i < DEFAULT_CUSTOMERS; i++) {
+        for (int j = 0; j < DEFAULT_RESOURCES; j++) {
+            row(maximum, i)[j] = max_matrix[i][j];
+        }
+    }
+}
+
+void initialize_system(void) {
+    for (int i = 0; i < number_of_resources; i++) {
+        printf("Resource R%d available: %d\n", i + 1, available[i]);
+    }
+
+    /* VERIFY: Total maximum demand should be <= total resources */
+    long long *total_max = allocate_array(number_of_resources, sizeof(long long), "the demand totals");
+    for (int i = 0; i < number_of_customers; i++) {
+        for (int j = 0; j < number_of_resources; j++) {
+            total_max[j] += row(maximum, i)[j];
+        }
+    }
+
+    printf("\nTotal maximum demand per resource: ");
+    for (int j = 0; j < number_of_resources; j++) {
+        printf("R%d: %lld/%d  ", j+1, total_max[j], available[j]);
+    }
+    printf("\n");
+    free(total_max);
+
+    for (int i = 0; i < number_of_customers; i++) {
+        for (int j = 0; j < number_of_resources; j++) {
+            row(allocation, i)[j] = 0;
+        }
+    }
+
+    for (int i = 0; i < number_of_customers; i++) {
+        for (int j = 0; j < number_of_resources; j++) {
+            row(need, i)[j] = row(maximum, i)[j] - row(allocation, i)[j];
+        }
+    }
+    build_need_order();
+
+    printf("System initialized successfully! (%d customers, %d resources, %s kernels)\n",
+           number_of_customers, number_of_resources, kernels.name);
+}
+
+void print_state() {
+    printf("\n=== CURRENT SYSTEM STATE ===\n");
+
+    printf("Available resources: ");
+    for (int j = 0; j < number_of_resources; j++) {
+        printf("R%d: %d  ", j + 1, available[j]);
+    }
+    printf("\n\n");
+
+    printf("Customer\tMax\t\tAllocation\tNeed\n");
+    printf("--------\t---\t\t----------\t----\n");
+
+    int shown = number_of_customers < PRINT_STATE_CUSTOMERS ? number_of_customers : PRINT_STATE_CUSTOMERS;
+    for (int i = 0; i < shown; i++) {
+        printf("C%d\t\t", i);
+
+        for (int j = 0; j < number_of_resources; j++) {
+            printf("%d ", row(maximum, i)[j]);
+        }
+        printf("\t");
+
+        for (int j = 0; j < number_of_resources; j++) {
+            printf("%d ", row(allocation, i)[j]);
+        }
+        printf("\t");
+
+        for (int j = 0; j < number_of_resources; j++) {
+            printf("%d ", row(need, i)[j]);
+        }
+        printf("\n");
+    }
+    if (shown < number_of_customers) {
+        printf("... %d more customers\n", number_of_customers - shown);
+    }
+    printf("=============================\n\n");
+}
+
+/* The textbook check: rescan from customer 0 for one that can finish,
+   O(n^2 m). Kept as the reference for --bench, with its original scalar
+   loops: most of its need tests fail on the first resource, where an
+   inlined loop beats a call to any kernel. */
+int is_safe_rescan() {
+    for (int i = 0; i < number_of_resources; i++) {
+        work[i] = available[i];
+    }
+
+    for (int i = 0; i < number_of_customers; i++) {
+        finish[i] = 0;
+    }
+
+    int found;
+    for (int count = 0; count < number_of_customers; count++) {
+        found = 0;
+
+        for (int i = 0; i < number_of_customers; i++) {
+            if (finish[i] == 0) {
+                const int *need_i = row(need, i);
+                int can_allocate = 1;
+
+                for (int j = 0; j < number_of_resources; j++) {
+                    if (need_i[j] > work[j]) {
+                        can_allocate = 0;
+                        break;
+                    }
+                }
+
+                if (can_allocate) {
+                    const int *allocation_i = row(allocation, i);
+                    for (int j = 0; j < number_of_resources; j++) {
+                        work[j] += allocation_i[j];
+                    }
+
+                    finish[i] = 1;
+                    found = 1;
+                    break;
+                }
+            }
+        }
+
+        if (!found) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* Wake the customers of resource j whose need fits in work[j] now; one
+   whose needs all fit goes on the ready stack. Returns the new top. */
+static int wake_customers(int j, int top) {
+    const int *key = resource_keys(j), *order = resource_order(j);
+    int k = cursor[j];
+    while (k < number_of_customers && key[k] <= work[j]) {
+        int i = order[k++];
+        if (--blocked[i] == 0) ready[top++] = i;
+    }
+    cursor[j] = k;
+    return top;
+}
+
+/* Worklist safety check, with the same answer as is_safe_rescan(). Per
+   resource a cursor walks the need order up to work[j], and a customer's
+   blocked count is the number of resources whose cursor has not passed it
+   yet. At 0 it can finish: it goes on the ready stack, and when it is
+   popped its allocation is added to work, which moves the cursors of only
+   the resources it held. Every cursor moves forward only, so a check is
+   O(n m). The finishing order may differ from the rescan's, but work only
+   grows, so either finds every customer that can finish. The order is
+   left in checked_sequence. */
+int is_safe() {
+    int top = 0, finished = 0;
+
+    memcpy(work, available, row_stride * sizeof(int));
+    for (int j = 0; j < number_of_resources; j++) {
+        cursor[j] = 0;
+    }
+    for (int i = 0; i < number_of_customers; i++) {
+        blocked[i] = number_of_resources;
+    }
+    for (int j = 0; j < number_of_resources; j++) {
+        top = wake_customers(j, top);
+    }
+
+    while (top > 0) {
+        int i = ready[--top];
+        const int *allocation_i = row(allocation, i);
+        checked_sequence[finished++] = i;
+        kernels.add(work, allocation_i, row_stride);
+        for (int j = 0; j < number_of_resources; j++) {
+            if (allocation_i[j] > 0) top = wake_customers(j, top);
+        }
+    }
+
+    return finished == number_of_customers;
+}
+
+/* ============================================================
+   INCREMENTAL SAFETY
+   The cached safe sequence comes with prefix_work[k], the work
+   vector before its k-th customer finishes: available plus the
+   allocations of the customers ahead of it. Granting request r to
+   customer c at position p takes r from available and adds it to
+   c's allocation, so it lowers prefix_work[0..p] by r and leaves
+   the later rows alone. c's own test at p still passes, as its
+   need shrank by r as well. The sequence therefore stays safe
+   exactly when the customers ahead of c still fit in
+   prefix_work - r, which is checked from position 0 and stops at
+   the first that does not. A release raises the same rows and
+   can only help, so it needs no check. When the sequence breaks,
+   a full is_safe() decides and its sequence is cached instead.
+   ============================================================ */
+int sequence_valid = 0;
+long safety_fast_checks = 0;    /* answered by the cached sequence */
+long safety_full_checks = 0;
+
+/* Cache the sequence of the last is_safe() that returned 1 */
+void cache_safe_sequence(void) {
+    memcpy(safe_sequence, checked_sequence, number_of_customers * sizeof(int));
+    memcpy(row(prefix_work, 0), available, row_stride * sizeof(int));
+    for (int k = 0; k < number_of_customers; k++) {
+        int i = safe_sequence[k];
+        sequence_position[i] = k;
+        if (k + 1 < number_of_customers) {
+            memcpy(row(prefix_work, k + 1), row(prefix_work, k), row_stride * sizeof(int));
+            kernels.add(row(prefix_work, k + 1), row(allocation, i), row_stride);
+        }
+    }
+    sequence_valid = 1;
+}
+
+/* Whether the state is safe now that customer has been given request
+   (already applied). When it is, the cache matches the new state; when
+   not, it still matches the state before, which the caller restores. */
+int is_safe_after_request(int customer, const int *request) {
+    if (sequence_valid) {
+        int p = sequence_position[customer], k;
+        for (k = 0; k < p; k++) {
+            memcpy(work, row(prefix_work, k), row_stride * sizeof(int));
+            kernels.sub(work, request, number_of_resources);
+            if (!kernels.fits(row(need, safe_sequence[k]), work, row_stride)) break;
+        }
+        if (k == p) {
+            for (k = 0; k <= p; k++) {
+                kernels.sub(row(prefix_work, k), request, number_of_resources);
+            }
+            safety_fast_checks++;
+            return 1;
+        }
+    }
+
+    safety_full_checks++;
+    if (!is_safe()) return 0;
+    cache_safe_sequence();
+    return 1;
+}
+
+/* Keep the cache in step with a release (already applied) */
+void release_from_sequence(int customer, const int *release) {
+    if (!sequence_valid) return;
+    for (int k = 0; k <= sequence_position[customer]; k++) {
+        kernels.add(row(prefix_work, k), release, number_of_resources);
+    }
+}
+
+/* Move request from available to the customer's allocation, and back */
+static void apply_request(int customer, const int *request) {
+    kernels.sub(available, request, number_of_resources);
+    kernels.add(row(allocation, customer), request, number_of_resources);
+    kernels.sub(row(need, customer), request, number_of_resources);
+    reposition_need(customer);
+}
+
+static void undo_request(int customer, const int *request) {
+    kernels.add(available, request, number_of_resources);
+    kernels.sub(row(allocation, customer), request, number_of_resources);
+    kernels.add(row(need, customer), request, number_of_resources);
+    reposition_need(customer);
+}
+
+int request_resources(int customer_num, int request[]) {
+    const int *need_c = row(need, customer_num);
+
+    if (verbose) {
+        printf("\nCustomer %d requesting: ", customer_num);
+        for (int j = 0; j < number_of_resources; j++) {
+            if (request[j] > 0) printf("R%d:%d ", j + 1, request[j]);
+        }
+        printf("\n");
+    }
+
+    if (!kernels.fits(request, need_c, number_of_resources)) {
+        if (verbose) printf("  ERROR: Request exceeds need\n");
+        requests_invalid++;
+        return -1;
+    }
+
+    if (!kernels.fits(request, available, number_of_resources)) {
+        if (verbose) printf("  Resources not available. Waiting...\n");
+        requests_unavailable++;
+        return -1;
+    }
+
+    apply_request(customer_num, request);
+
+    if (is_safe_after_request(customer_num, request)) {
+        if (verbose) printf("  Request GRANTED to Customer %d\n", customer_num);
+        requests_granted++;
+        return 0;
+    } else {
+        if (verbose) printf("  Request DENIED to Customer %d (unsafe)\n", customer_num);
+        requests_unsafe++;
+        undo_request(customer_num, request);
+        return -1;
+    }
+}
+
+int release_resources(int customer_num, int release[]) {
+    int *allocation_c = row(allocation, customer_num);
+    int *need_c = row(need, customer_num);
+
+    if (verbose) {
+        printf("\nCustomer %d releasing: ", customer_num);
+        for (int j = 0; j < number_of_resources; j++) {
+            if (release[j] > 0) printf("R%d:%d ", j + 1, release[j]);
+        }
+        printf("\n");
+    }
+
+    if (!kernels.fits(release, allocation_c, number_of_resources)) {
+        if (verbose) printf("  ERROR: Cannot release more than allocated\n");
+        return -1;
+    }
+
+    /* need + allocation stays equal to maximum */
+    kernels.add(available, release, number_of_resources);
+    kernels.sub(allocation_c, release, number_of_resources);
+    kernels.add(need_c, release, number_of_resources);
+    reposition_need(customer_num);
+    release_from_sequence(customer_num, release);
+
+    if (verbose) printf("  Resources released successfully\n");
+    return 0;
+}
+
+/* ============================================================
+   BATCHED ADMISSION (--combine)
+   Flat combining: instead of each taking mutex_lock for its own
+   request, customer threads push their requests and releases
+   onto a lock-free stack. Whichever thread gets mutex_lock takes
+   everything pushed so far with one atomic exchange, admits it as
+   a batch, and repeats until the stack is empty; the others wait
+   for their verdict, or to take over. A batch applies its
+   releases, then tentatively applies every request that fits and
+   runs one safety analysis over the lot (is_safe_after_batch()).
+   If that is safe the whole batch is granted. If not, the batch
+   is rolled back and admitted one request at a time, smallest
+   first, through request_resources(): a greedy approximation of
+   the largest safe subset, as finding the exact one is a subset
+   search.
+   ============================================================ */
+typedef struct admission {
+    struct admission *next;
+    int customer;
+    int is_release;
+    int *vector;
+    int units;                  /* sum of vector, for smallest first */
+    int result;                 /* as request_resources() returns */
+    int done;                   /* result is ready */
+    struct timespec submitted;
+} admission;
+
+int combining = 0;
+admission *submissions = NULL;  /* lock-free stack, newest first */
+admission **combine_batch;      /* [2 * threads]: the batch, then its requests */
+int batch_capacity;             /* at most one admission per thread */
+
+/* Under mutex_lock */
+long batches = 0;               /* with at least one request */
+long batched_requests = 0;
+long batch_fallbacks = 0;       /* batches admitted one by one */
+latency_hist admission_latency; /* ns from asking to the verdict */
+
+static long long nanoseconds_between(const struct timespec *a, const struct timespec *b) {
+    return (b->tv_sec - a->tv_sec) * 1000000000LL + (b->tv_nsec - a->tv_nsec);
+}
+
+/* is_safe_after_request() for several requests at once, all already
+   applied. Walking the cached sequence from the front, prefix_work[k]
+   drops by every request of a customer at position k or later. A
+   requester's own test at its position comes out as need <= prefix_work
+   minus the other requests at or after it, like any other customer's. */
+static int is_safe_after_batch(admission **requests, int count) {
+    if (sequence_valid) {
+        for (int r = 1; r < count; r++) {
+            admission *a = requests[r];
+            int m = r;
+            for (; m > 0 && sequence_position[requests[m - 1]->customer] > sequence_position[a->customer]; m--)
+                requests[m] = requests[m - 1];
+            requests[m] = a;
+        }
+        memset(pending, 0, row_stride * sizeof(int));
+        for (int r = 0; r < count; r++) kernels.add(pending, requests[r]->vector, number_of_resources);
+
+        int last = sequence_position[requests[count - 1]->customer], next = 0, k;
+        for (k = 0; k <= last; k++) {
+            memcpy(work, row(prefix_work, k), row_stride * sizeof(int));
+            kernels.sub(work, pending, row_stride);
+            if (!kernels.fits(row(need, safe_sequence[k]), work, row_stride)) break;
+            for (; next < count && sequence_position[requests[next]->customer] == k; next++)
+                kernels.sub(pending, requests[next]->vector, number_of_resources);
+        }
+        if (k > last) {
+            memset(pending, 0, row_stride * sizeof(int));
+            for (int r = 0; r < count; r++) kernels.add(pending, requests[r]->vector, number_of_resources);
+            next = 0;
+            for (k = 0; k <= last; k++) {
+                kernels.sub(row(prefix_work, k), pending, row_stride);
+                for (; next < count && sequence_position[requests[next]->customer] == k; next++)
+                    kernels.sub(pending, requests[next]->vector, number_of_resources);
+            }
+            safety_fast_checks++;
+            return 1;
+        }
+    }
+
+    safety_full_checks++;
+    if (!is_safe()) return 0;
+    cache_safe_sequence();
+    return 1;
+}
+
+/* Grant what can be granted of one batch and hand out the verdicts */
+static void admit_batch(admission **batch, int count, admission **applied) {
+    int requests = 0, tentative = 0;
+
+    for (int b = 0; b < count; b++) {
+        if (batch[b]->is_release) batch[b]->result = release_resources(batch[b]->customer, batch[b]->vector);
+    }
+    for (int b = 0; b < count; b++) {
+        admission *a = batch[b];
+        if (a->is_release) continue;
+        requests++;
+        a->result = -1;
+        if (!kernels.fits(a->vector, row(need, a->customer), number_of_resources)) {
+            requests_invalid++;
+        } else if (!kernels.fits(a->vector, available, number_of_resources)) {
+            requests_unavailable++;
+        } else {
+            apply_request(a->customer, a->vector);
+            applied[tentative++] = a;
+        }
+    }
+
+    if (tentative > 0) {
+        if (is_safe_after_batch(applied, tentative)) {
+            requests_granted += tentative;
+            for (int k = 0; k < tentative; k++) applied[k]->result = 0;
+            if (verbose) printf("\nBatch of %d requests GRANTED\n", tentative);
+        } else {
+            batch_fallbacks++;
+            for (int k = tentative - 1; k >= 0; k--) undo_request(applied[k]->customer, applied[k]->vector);
+            for (int k = 1; k < tentative; k++) {
+                admission *a = applied[k];
+                int m = k;
+                for (; m > 0 && applied[m - 1]->units > a->units; m--) applied[m] = applied[m - 1];
+                applied[m] = a;
+            }
+            for (int k = 0; k < tentative; k++) {
+                applied[k]->result = request_resources(applied[k]->customer, applied[k]->vector);
+            }
+        }
+    }
+    if (requests > 0) {
+        batches++;
+        batched_requests += requests;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    for (int b = 0; b < count; b++) {
+        if (!batch[b]->is_release) {
+            latency_hist_record(&admission_latency, nanoseconds_between(&batch[b]->submitted, &now));
+        }
+        __atomic_store_n(&batch[b]->done, 1, __ATOMIC_RELEASE);
+    }
+}
+
+/* Admit batches until nothing is pushed; under mutex_lock */
+static void combine(void) {
+    admission *list;
+    while ((list = __atomic_exchange_n(&submissions, NULL, __ATOMIC_ACQUIRE)) != NULL) {
+        int count = 0;
+        for (admission *a = list; a != NULL; a = a->next) count++;
+        int b = count;
+        for (admission *a = list; a != NULL; a = a->next) combine_batch[--b] = a;   /* oldest first */
+        admit_batch(combine_batch, count, combine_batch + batch_capacity);
+    }
+}
+
+void start_combining(int threads) {
+    batch_capacity = threads;
+    combine_batch = allocate_array(2 * (size_t)threads, sizeof(admission *), "the combining batch");
+    combining = 1;
+}
+
+void stop_combining(void) {
+    combining = 0;
+    free(combine_batch);
+}
+
+static int submit(admission *a) {
+    a->done = 0;
+    admission *head = __atomic_load_n(&submissions, __ATOMIC_RELAXED);
+    do {
+        a->next = head;
+    } while (!__atomic_compare_exchange_n(&submissions, &head, a, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    while (!__atomic_load_n(&a->done, __ATOMIC_ACQUIRE)) {
+        if (pthread_mutex_trylock(&mutex_lock) == 0) {
+            combine();
+            pthread_mutex_unlock(&mutex_lock);
+        } else {
+            sched_yield();
+        }
+    }
+    return a->result;
+}
+
+/* request_resources() batched with other threads' or under mutex_lock.
+   slot is the calling thread's own. */
+int admit_request(admission *slot, int customer, int *request) {
+    clock_gettime(CLOCK_MONOTONIC, &slot->submitted);
+    if (combining) {
+        slot->customer = customer;
+        slot->is_release = 0;
+        slot->vector = request;
+        slot->units = 0;
+        for (int j = 0; j < number_of_resources; j++) slot->units += request[j];
+        return submit(slot);
+    }
+
+    pthread_mutex_lock(&mutex_lock);
+    int result = request_resources(customer, request);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    latency_hist_record(&admission_latency, nanoseconds_between(&slot->submitted, &now));
+    batches++;
+    batched_requests++;
+    pthread_mutex_unlock(&mutex_lock);
+    return result;
+}
+
+int admit_release(admission *slot, int customer, int *release) {
+    if (combining) {
+        slot->customer = customer;
+        slot->is_release = 1;
+        slot->vector = release;
+        return submit(slot);
+    }
+
+    pthread_mutex_lock(&mutex_lock);
+    int result = release_resources(customer, release);
+    pthread_mutex_unlock(&mutex_lock);
+    return result;
+}
+
+/* Thread t plays customers t, t + threads, t + 2 * threads, ... in turn */
+int number_of_threads;
+
+void* customer_thread(void* arg) {
+    int first_customer = *(int*)arg;
+    unsigned int seed = time(NULL) + first_customer;
+    int *request = allocate_array(row_stride, sizeof(int), "a request");
+    int customer_id = first_customer;
+    admission slot;
+
+    if (verbose) printf("Customer %d started\n", customer_id);
+
+    for (; running; customer_id += number_of_threads) {
+        if (customer_id >= number_of_customers) customer_id = first_customer;
+        const int *need_c = row(need, customer_id);
+
+        /* Generate SMART requests that are more likely to succeed */
+        memset(request, 0, row_stride * sizeof(int));
+
+        /* Strategy: Request small amounts, not everything at once */
+        for (int j = 0; j < number_of_resources; j++) {
+            if (need_c[j] > 0) {
+                /* Request 0-50% of remaining need, but max 2 of any resource */
+                int max_request = need_c[j];
+                if (max_request > 2) max_request = 2;
+                request[j] = rand_r(&seed) % (max_request + 1);
+            }
+        }
+
+        /* Don't make empty requests */
+        int all_zero = 1;
+        for (int j = 0; j < number_of_resources; j++) {
+            if (request[j] > 0) {
+                all_zero = 0;
+                break;
+            }
+        }
+        if (all_zero) {
+            usleep(200000);
+            continue;
+        }
+
+        int result = admit_request(&slot, customer_id, request);
+
+        if (result == 0) {
+            if (verbose) printf("Customer %d using resources...\n", customer_id);
+
+            /* Use resources for 1-4 seconds */
+            int use_time = 1 + (rand_r(&seed) % 4);
+            sleep(use_time);
+
+            admit_release(&slot, customer_id, request);
+
+            if (verbose) printf("Customer %d finished using resources\n", customer_id);
+        } else {
+            if (verbose) printf("Customer %d request denied\n", customer_id);
+        }
+
+        /* Wait 1-3 seconds before next request */
+        int delay = 1 + (rand_r(&seed) % 3);
+        sleep(delay);
+    }
+
+    if (verbose) printf("Thread for customer %d exiting\n", first_customer);
+    free(request);
+    return NULL;
+}
+
+/* ============================================================
+   SAFETY CHECK BENCHMARK
+   Random states with BENCH_RESOURCES resource types, each just
+   safe or with 8 spare units of every resource, played like
+   the simulation: a customer asks for one more unit of a few
+   resources, an unsafe request is rolled back, and a granted one
+   is held until BENCH_HELD newer grants have come in, or until
+   a request is denied, then released. Every request is checked three ways on the same
+   state: the rescan, the worklist (including keeping the need
+   orders sorted) and the incremental check (including keeping
+   the cached sequence in step with releases).
+   ============================================================ */
+#define BENCH_RESOURCES 16
+#define BENCH_HELD 32
+#define BENCH_MAX_CHECKS 2000
+#define BENCH_SECONDS 1.0       /* per size, for the slowest check */
+
+static double seconds_between(const struct timespec *a, const struct timespec *b) {
+    return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec) / 1e9;
+}
+
+/* A random state that is just safe, plus spare units of every resource */
+static void random_state(int customers, int spare, unsigned int *seed) {
+    allocate_state(customers, BENCH_RESOURCES);
+    for (int i = 0; i < customers; i++) {
+        for (int j = 0; j < BENCH_RESOURCES; j++) {
+            int max = rand_r(seed) % 10;
+            row(maximum, i)[j] = max;
+            row(allocation, i)[j] = rand_r(seed) % (max + 1) / 2;
+            row(need, i)[j] = max - row(allocation, i)[j];
+        }
+    }
+    for (int j = 0; j < BENCH_RESOURCES; j++) {
+        available[j] = 6 + rand_r(seed) % 6;
+    }
+    build_need_order();
+    while (!is_safe()) {
+        for (int j = 0; j < BENCH_RESOURCES; j++) available[j]++;
+    }
+    for (int j = 0; j < BENCH_RESOURCES; j++) {
+        available[j] += spare;
+    }
+    cache_safe_sequence();
+}
+
+int run_safety_benchmark(void) {
+    static const int sizes[] = { 1000, 2000, 5000, 10000 };
+    static const int spares[] = { 0, 8 };
+    unsigned int seed = 42;
+    int held_customer[BENCH_HELD];
+    int *held = NULL, *request = NULL;
+
+    printf("\n=== SAFETY CHECK BENCHMARK (%d resources, %s kernels) ===\n", BENCH_RESOURCES, kernels.name);
+    printf("Customers\tSpare\tChecks\tSafe\tRescan (us)\tWorklist (us)\tIncremental (us)\tFast path\n");
+    for (int run = 0; run < (int)(sizeof(sizes) / sizeof(sizes[0]) * 2); run++) {
+        int customers = sizes[run / 2], spare = spares[run % 2];
+        random_state(customers, spare, &seed);
+        free(held);
+        held = allocate_array((size_t)BENCH_HELD * row_stride, sizeof(int), "the held requests");
+        free(request);
+        request = allocate_array(row_stride, sizeof(int), "a request");
+        safety_fast_checks = safety_full_checks = 0;
+        double rescan_time = 0, worklist_time = 0, incremental_time = 0;
+        int checks = 0, safe = 0, held_count = 0, next_held = 0, denied = 0;
+
+        while (checks < BENCH_MAX_CHECKS && rescan_time < BENCH_SECONDS) {
+            struct timespec t0, t1, t2, t3, t4;
+
+            if (held_count == BENCH_HELD || (denied && held_count > 0)) {
+                int c = held_customer[next_held], *release = held + (size_t)next_held * row_stride;
+                kernels.add(available, release, number_of_resources);
+                kernels.sub(row(allocation, c), release, number_of_resources);
+                kernels.add(row(need, c), release, number_of_resources);
+                clock_gettime(CLOCK_MONOTONIC, &t0);
+                reposition_need(c);
+                clock_gettime(CLOCK_MONOTONIC, &t1);
+                release_from_sequence(c, release);
+                clock_gettime(CLOCK_MONOTONIC, &t2);
+                worklist_time += seconds_between(&t0, &t1);
+                incremental_time += seconds_between(&t0, &t2);
+                next_held = (next_held + 1) % BENCH_HELD;
+                held_count--;
+            }
+
+            int c = rand_r(&seed) % number_of_customers, units = 0;
+            int *allocation_c = row(allocation, c), *need_c = row(need, c);
+            for (int j = 0; j < number_of_resources; j++) {
+                request[j] = need_c[j] > 0 && available[j] > 0 && rand_r(&seed) % 4 == 0;
+                units += request[j];
+            }
+            if (units == 0) continue;
+            kernels.sub(available, request, number_of_resources);
+            kernels.add(allocation_c, request, number_of_resources);
+            kernels.sub(need_c, request, number_of_resources);
+
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            int expected = is_safe_rescan();
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            reposition_need(c);
+            clock_gettime(CLOCK_MONOTONIC, &t2);
+            int answer = is_safe();
+            clock_gettime(CLOCK_MONOTONIC, &t3);
+            int incremental = is_safe_after_request(c, request);
+            clock_gettime(CLOCK_MONOTONIC, &t4);
+            if (answer != expected || incremental != expected) {
+                printf("ERROR: is_safe() says %d, is_safe_after_request() %d, the rescan %d "
+                       "(customer %d, check %d)\n", answer, incremental, expected, c, checks);
+                return EXIT_FAILURE;
+            }
+            rescan_time += seconds_between(&t0, &t1);
+            worklist_time += seconds_between(&t1, &t3);
+            incremental_time += seconds_between(&t1, &t2) + seconds_between(&t3, &t4);
+            checks++;
+
+            denied = !expected;
+            if (expected) {
+                int slot = (next_held + held_count++) % BENCH_HELD;
+                held_customer[slot] = c;
+                memcpy(held + (size_t)slot * row_stride, request, number_of_resources * sizeof(int));
+                safe++;
+            } else {
+                kernels.add(available, request, number_of_resources);
+                kernels.sub(allocation_c, request, number_of_resources);
+                kernels.add(need_c, request, number_of_resources);
+                reposition_need(c);
+            }
+        }
+        printf("%d\t\t%d\t%d\t%.0f%%\t%.1f\t\t%.1f\t\t%.1f\t\t\t%.1f%%\n", customers, spare, checks,
+               100.0 * safe / checks, 1e6 * rescan_time / checks, 1e6 * worklist_time / checks,
+               1e6 * incremental_time / checks, 100.0 * safety_fast_checks / checks);
+        free(arena);
+    }
+    free(held);
+    free(request);
+    return EXIT_SUCCESS;
+}
+
+/* ============================================================
+   KERNEL MICROBENCHMARK
+   fits() and add() of every kernel the CPU supports, over
+   KERNEL_BENCH_ROWS padded rows: every need row fits, so fits()
+   never stops early.
+   ============================================================ */
+#define KERNEL_BENCH_ROWS 4096
+#define KERNEL_BENCH_OPS 20000000L    /* row operations per timing */
+
+int run_kernel_benchmark(void) {
+    static const int resource_counts[] = { 4, 8, 16, 32, 64, 128, 256, 1024 };
+
+    printf("\n=== VECTOR KERNEL BENCHMARK (%d rows, ns per row) ===\n", KERNEL_BENCH_ROWS);
+    printf("Resources");
+    for (int k = 0; k < KERNEL_COUNT; k++) {
+        if (kernel_supported(&kernel_table[k])) printf("\t%s fits\t%s add", kernel_table[k].name,
+                                                       kernel_table[k].name);
+    }
+    printf("\n");
+
+    for (int r = 0; r < (int)(sizeof(resource_counts) / sizeof(resource_counts[0])); r++) {
+        allocate_state(KERNEL_BENCH_ROWS, resource_counts[r]);
+        for (int i = 0; i < KERNEL_BENCH_ROWS; i++) {
+            for (int j = 0; j < number_of_resources; j++) {
+                row(need, i)[j] = (i + j) % 7;
+                row(allocation, i)[j] = (i * j) % 3;
+            }
+        }
+        for (int j = 0; j < number_of_resources; j++) work[j] = 7;
+
+        long passes = KERNEL_BENCH_OPS / KERNEL_BENCH_ROWS / (row_stride / INTS_PER_LINE);
+        printf("%d\t", number_of_resources);
+        for (int k = 0; k < KERNEL_COUNT; k++) {
+            const vector_kernels *kernel = &kernel_table[k];
+            if (!kernel_supported(kernel)) continue;
+            struct timespec t0, t1, t2;
+            long fit = 0;
+
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            for (long p = 0; p < passes; p++) {
+                for (int i = 0; i < KERNEL_BENCH_ROWS; i++) fit += kernel->fits(row(need, i), work, row_stride);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            for (long p = 0; p < passes; p++) {
+                for (int i = 0; i < KERNEL_BENCH_ROWS; i++) kernel->add(work, row(allocation, i), row_stride);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &t2);
+
+            if (fit != passes * KERNEL_BENCH_ROWS) {
+                printf("\nERROR: %s fits() gave a wrong answer\n", kernel->name);
+                return EXIT_FAILURE;
+            }
+            double rows = (double)passes * KERNEL_BENCH_ROWS;
+            printf("\t%.2f\t\t%.2f", 1e9 * seconds_between(&t0, &t1) / rows,
+                   1e9 * seconds_between(&t1, &t2) / rows);
+            for (int j = 0; j < number_of_resources; j++) work[j] = 7;
+        }
+        printf("\n");
+        free(arena);
+    }
+    return EXIT_SUCCESS;
+}
+
+/* ============================================================
+   ADMISSION BENCHMARK
+   Closed loop, without the simulation's sleeps: each thread asks
+   for one unit of a few resources for one of its customers and
+   gives a grant straight back, for ADMISSION_SECONDS, at every
+   thread count and spare level, under mutex_lock and then batched
+   (--combine). Every run starts from the same random state for
+   its spare level: with 8 spare units of every resource most
+   requests are safe and batches pass together; with none, most
+   batches are unsafe together and fall back to one by one.
+   ============================================================ */
+#define ADMISSION_CUSTOMERS 1000
+#define ADMISSION_SECONDS 0.5
+
+typedef struct {
+    int first_customer;
+    long requests;
+    long grants;
+} admission_worker;
+
+void* admission_bench_thread(void* arg) {
+    admission_worker *w = arg;
+    unsigned int seed = 1 + w->first_customer;
+    int *request = allocate_array(row_stride, sizeof(int), "a request");
+    admission slot;
+
+    for (int c = w->first_customer; running; c += number_of_threads) {
+        if (c >= number_of_customers) c = w->first_customer;
+        const int *need_c = row(need, c);
+        int units = 0;
+        for (int j = 0; j < number_of_resources; j++) {
+            request[j] = need_c[j] > 0 && rand_r(&seed) % 4 == 0;
+            units += request[j];
+        }
+        if (units == 0) continue;
+
+        w->requests++;
+        if (admit_request(&slot, c, request) == 0) {
+            w->grants++;
+            admit_release(&slot, c, request);
+        }
+    }
+    free(request);
+    return NULL;
+}
+
+int run_admission_benchmark(void) {
+    static const int thread_counts[] = { 1, 2, 4, 8, 16, 32 };
+    static const int spares[] = { 0, 8 };
+    admission_worker workers[32];
+    pthread_t ids[32];
+
+    verbose = 0;
+    pthread_mutex_init(&mutex_lock, NULL);
+    printf("\n=== ADMISSION BENCHMARK (%d customers, %d resources, %s kernels) ===\n",
+           ADMISSION_CUSTOMERS, BENCH_RESOURCES, kernels.name);
+    printf("Threads\tSpare\tMode\tRequests/s\tGrants/s\tp50 (us)\tp99 (us)\tBatch\tFallbacks\n");
+    for (int run = 0; run < (int)(sizeof(thread_counts) / sizeof(thread_counts[0])) * 4; run++) {
+        int threads = thread_counts[run / 4], spare = spares[run / 2 % 2], combine = run % 2;
+        unsigned int seed = 42;
+        random_state(ADMISSION_CUSTOMERS, spare, &seed);
+        latency_hist_reset(&admission_latency);
+        batches = batched_requests = batch_fallbacks = 0;
+        number_of_threads = threads;
+        running = 1;
+        if (combine) start_combining(threads);
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int t = 0; t < threads; t++) {
+            workers[t] = (admission_worker){t, 0, 0};
+            if (pthread_create(&ids[t], NULL, admission_bench_thread, &workers[t]) != 0) {
+                printf("Failed to create benchmark thread %d\n", t);
+                return EXIT_FAILURE;
+            }
+        }
+        struct timespec pause = {0, (long)(ADMISSION_SECONDS * 1e9)};
+        nanosleep(&pause, NULL);
+        running = 0;
+        long requests = 0, grants = 0;
+        for (int t = 0; t < threads; t++) {
+            pthread_join(ids[t], NULL);
+            requests += workers[t].requests;
+            grants += workers[t].grants;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (combine) stop_combining();
+
+        double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("%d\t%d\t%s\t%.0f\t\t%.0f\t\t%.1f\t\t%.1f\t\t%.1f\t%ld\n", threads, spare,
+               combine ? "combine" : "mutex",
+               requests / seconds, grants / seconds,
+               latency_hist_percentile(&admission_latency, 0.50) / 1e3,
+               latency_hist_percentile(&admission_latency, 0.99) / 1e3,
+               batches > 0 ? (double)batched_requests / batches : 0.0, batch_fallbacks);
+        if (!is_safe()) {
+            printf("ERROR: the state ended unsafe\n");
+            return EXIT_FAILURE;
+        }
+        free(arena);
+    }
+    printf("\nSpare: units of every resource left over in the starting state\n");
+    printf("Batch: requests per safety analysis (1 under the mutex)\n");
+    printf("Fallbacks: batches that were unsafe together, admitted one by one\n");
+    pthread_mutex_destroy(&mutex_lock);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+    const char *config = NULL;
+    int threads = 0, seconds = DEFAULT_SECONDS;
+    char *resource_args[DEFAULT_RESOURCES + 2] = {argv[0]};
+    int resource_count = 0, bench = 0, bench_kernels = 0, bench_admission = 0, combine = 0;
+
+    select_kernels(NULL);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--config") == 0 && i + 1 < argc) config = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = strtol(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = strtol(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--quiet") == 0) verbose = 0;
+        else if (strcmp(argv[i], "--bench") == 0) bench = 1;
+        else if (strcmp(argv[i], "--bench-kernels") == 0) bench_kernels = 1;
+        else if (strcmp(argv[i], "--bench-admission") == 0) bench_admission = 1;
+        else if (strcmp(argv[i], "--combine") == 0) combine = 1;
+        else if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc) {
+            if (!select_kernels(argv[++i])) {
+                printf("Error: Kernel '%s' is unknown or not supported by this CPU\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (argv[i][0] != '-' && resource_count < DEFAULT_RESOURCES) resource_args[++resource_count] = argv[i];
+        else {
+            printf("Usage: %s [r1 r2 r3 r4 r5 | --config FILE] [--threads N] [--seconds S] [--quiet]"
+                   " [--combine]\n", argv[0]);
+            printf("       %s --bench | --bench-kernels | --bench-admission [--kernel scalar|sse4|avx2]\n",
+                   argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (bench) return run_safety_benchmark();
+    if (bench_kernels) return run_kernel_benchmark();
+    if (bench_admission) return run_admission_benchmark();
+
+    printf("\n============ BANKER'S ALGORITHM SIMULATION ============\n");
+
+    if (config != NULL) {
+        printf("Loading configuration from %s\n", config);
+        load_config(config);
+    } else if (resource_count == 0) {
+        /* Use default values if no arguments provided */
+        printf("Using default resource values: 10 5 7 3 2\n");
+        char* default_args[] = {"./banker", "10", "5", "7", "3", "2", NULL};
+        load_default_system(6, default_args);
+    } else {
+        load_default_system(resource_count + 1, resource_args);
+    }
+    initialize_system();
+
+    if (pthread_mutex_init(&mutex_lock, NULL) != 0) {
+        printf("Mutex initialization failed\n");
+        return EXIT_FAILURE;
+    }
+
+    print_state();
+
+    printf("\nChecking initial system safety...\n");
+    pthread_mutex_lock(&mutex_lock);
+    int initial_safe = is_safe();
+    pthread_mutex_unlock(&mutex_lock);
+
+    if (!initial_safe) {
+        printf("ERROR: Initial system state is unsafe!\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("Initial state is SAFE ✓\n");
+    cache_safe_sequence();
+
+    if (threads <= 0) threads = number_of_customers < MAX_DEFAULT_THREADS ? number_of_customers : MAX_DEFAULT_THREADS;
+    if (threads > number_of_customers) threads = number_of_customers;
+    number_of_threads = threads;
+    pthread_t *customers = allocate_array(threads, sizeof(pthread_t), "the customer threads");
+    int *customer_ids = allocate_array(threads, sizeof(int), "the customer threads");
+
+    printf("\nCreating %d customer threads for %d customers...\n", threads, number_of_customers);
+    if (combine) {
+        printf("Admitting requests in batches (flat combining)\n");
+        start_combining(threads);
+    }
+
+    for (int i = 0; i < threads; i++) {
+        customer_ids[i] = i;
+        if (pthread_create(&customers[i], NULL, customer_thread, &customer_ids[i]) != 0) {
+            printf("Failed to create thread for customer %d\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("\n=== SIMULATION STARTED ===\n");
+    printf("Running for %d seconds...\n\n", seconds);
+
+    /* Run simulation */
+    for (int t = 0; t < seconds; t++) {
+        printf("[Time: %02d sec] ", t);
+        fflush(stdout);
+        sleep(1);
+    }
+
+    printf("\n\n=== STOPPING SIMULATION ===\n");
+    running = 0;
+
+    /* Wait for threads */
+    for (int i = 0; i < threads; i++) {
+        pthread_join(customers[i], NULL);
+        if (verbose) printf("Customer %d joined\n", i);
+    }
+    free(customers);
+    free(customer_ids);
+    if (combine) stop_combining();
+
+    pthread_mutex_destroy(&mutex_lock);
+
+    printf("\n=== FINAL STATE ===\n");
+    print_state();
+    printf("Requests: %ld granted, %ld denied as unsafe, %ld waiting for resources, %ld over the need\n",
+           requests_granted, requests_unsafe, requests_unavailable, requests_invalid);
+    long safety_checks = safety_fast_checks + safety_full_checks;
+    printf("Safety checks: %ld, %ld (%.1f%%) answered by the cached safe sequence\n", safety_checks,
+           safety_fast_checks, safety_checks > 0 ? 100.0 * safety_fast_checks / safety_checks : 0.0);
+    if (combine) {
+        printf("Batches: %ld, %.2f requests each, %ld admitted one by one\n", batches,
+               batches > 0 ? (double)batched_requests / batches : 0.0, batch_fallbacks);
+    }
+    printf("\n");
+    latency_hist_print_header("Admission (ns)");
+    latency_hist_print("Request", &admission_latency);
+
+    printf("Final safety check: ");
+    int final_safe = is_safe();
+
+    if (final_safe) {
+        printf("SAFE ✓\n\nSUCCESS: Simulation completed without deadlock!\n");
+    } else {
+        printf("UNSAFE ✗\n\nWARNING: Simulation ended in unsafe state!\n");
+    }
+
+    free(arena);
+    printf("\n============ SIMULATION COMPLETE ============\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,267 @@
+// Multilevel feedback queue scheduling (level 0 = highest priority)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include "rr_queue.h"
+#include "process_table.h"
+
+// Usage: ./mlfq TRACE_FILE [--quanta Q0,Q1,...] [--boost TICKS] [--short TICKS]
+//
+// TRACE_FILE holds "arrival burst" lines (see workload_file.h). Every level
+// is round robin with its own quantum; a job enters at level 0, and moves
+// down a level once it has used up a whole quantum there. Every --boost
+// ticks all jobs go back to level 0 (0 turns boosting off). Jobs with a
+// burst of at most --short ticks are reported as short; by default that
+// is every job that can finish before reaching the bottom level.
+
+#define MLFQ_MAX_LEVELS 64          // one bitmap word, as in prio_array.h
+#define MLFQ_DEFAULT_BOOST 1000
+
+static const int defaultQuanta[] = { 2, 4, 8, 16 };
+
+// One round robin ring per level, and a bitmap of the non-empty levels so
+// the best one is a find-first-set away (the priority array of priority.c).
+// Per job, alongside the process table: its level, and the time it has
+// left at that level before demotion.
+struct Mlfq {
+    rr_queue queue[MLFQ_MAX_LEVELS];
+    uint64_t bitmap;
+    int levels;
+    int quantum[MLFQ_MAX_LEVELS];
+    int *level;
+    int *allotment;
+};
+
+struct MlfqStats {
+    long dispatches;
+    long preemptions;           // a job arriving at a better level took the CPU
+    long demotions;
+    long boosts;
+    long long idleTime;
+    long finishedAt[MLFQ_MAX_LEVELS];
+};
+
+static void mlfqPush(struct Mlfq *m, int j, int level) {
+    m->level[j] = level;
+    rr_push(&m->queue[level], j);
+    m->bitmap |= 1ULL << level;
+}
+
+static int mlfqPop(struct Mlfq *m, int level) {
+    int j = rr_pop(&m->queue[level]);
+    if (m->queue[level].count == 0) m->bitmap &= ~(1ULL << level);
+    return j;
+}
+
+// Priority boost: every waiting job moves to the back of level 0, best
+// level first, with a fresh level 0 allotment
+static void mlfqBoost(struct Mlfq *m) {
+    uint64_t levels = m->bitmap & ~1ULL;
+    while (levels) {
+        int level = __builtin_ctzll(levels);
+        levels &= levels - 1;
+        while (m->queue[level].count > 0) {
+            int j = mlfqPop(m, level);
+            m->allotment[j] = m->quantum[0];
+            mlfqPush(m, j, 0);
+        }
+    }
+}
+
+// Event-driven: time moves straight to the next completion, quantum
+// expiry, boost, or an arrival that preempts a job below level 0. Arrivals
+// by the end of a quantum join level 0 ahead of the job it expired for, as
+// in Round_robin.c. A preempted job keeps what is left of its allotment,
+// so running in short pieces does not dodge demotion. The table ends up
+// sorted by arrival.
+static void runMlfq(struct Mlfq *m, process_table *pt, int boostInterval, struct MlfqStats *st) {
+    int n = pt->count;
+    const int *arrival = pt->arrival;
+    int *remaining = pt->remaining;
+    int *level = NULL, *allotment = NULL;
+    long long now = 0;
+    long long nextBoost = boostInterval > 0 ? boostInterval : LLONG_MAX;
+    int completed = 0;
+    int next = 0;               // next job to arrive
+    int running = -1;
+
+    memset(st, 0, sizeof(*st));
+    pt_sort_by(pt, pt->arrival);
+    level = m->level = malloc(n * sizeof(int));
+    allotment = m->allotment = malloc(n * sizeof(int));
+    if (level == NULL || allotment == NULL) {
+        printf("Out of memory for %d jobs\n", n);
+        exit(EXIT_FAILURE);
+    }
+    m->bitmap = 0;
+    for (int l = 0; l < m->levels; l++) rr_queue_init(&m->queue[l], 0);
+
+    while (completed < n) {
+        // Idle CPU: jump to the next arrival
+        if (running < 0 && m->bitmap == 0 && now < arrival[next]) {
+            st->idleTime += arrival[next] - now;
+            now = arrival[next];
+        }
+        while (next < n && arrival[next] <= now) {
+            allotment[next] = m->quantum[0];
+            mlfqPush(m, next++, 0);
+        }
+        if (nextBoost <= now) {
+            mlfqBoost(m);
+            if (running >= 0) {
+                level[running] = 0;
+                allotment[running] = m->quantum[0];
+            }
+            st->boosts++;
+            nextBoost = (now / boostInterval + 1) * boostInterval;
+        }
+
+        if (running >= 0 && m->bitmap != 0 && __builtin_ctzll(m->bitmap) < level[running]) {
+            mlfqPush(m, running, level[running]);
+            running = -1;
+            st->preemptions++;
+        }
+        if (running < 0) {
+            running = mlfqPop(m, __builtin_ctzll(m->bitmap));
+            st->dispatches++;
+            if (pt->start[running] < 0) pt->start[running] = now;
+        }
+
+        // Run until the next event
+        int j = running;
+        long long until = now + (remaining[j] < allotment[j] ? remaining[j] : allotment[j]);
+        if (level[j] > 0 && next < n && arrival[next] < until) until = arrival[next];
+        if (nextBoost < until) until = nextBoost;
+        remaining[j] -= (int)(until - now);
+        allotment[j] -= (int)(until - now);
+        now = until;
+
+        if (remaining[j] == 0) {
+            pt_finish(pt, j, now);
+            st->finishedAt[level[j]]++;
+            completed++;
+            running = -1;
+        } else if (allotment[j] == 0) {
+            while (next < n && arrival[next] <= now) {
+                allotment[next] = m->quantum[0];
+                mlfqPush(m, next++, 0);
+            }
+            int l = level[j] + 1 < m->levels ? level[j] + 1 : level[j];
+            if (l != level[j]) st->demotions++;
+            allotment[j] = m->quantum[l];
+            mlfqPush(m, j, l);
+            running = -1;
+        }
+    }
+    for (int l = 0; l < m->levels; l++) rr_queue_free(&m->queue[l]);
+    free(m->level);
+    free(m->allotment);
+    m->level = m->allotment = NULL;
+}
+
+// Turnaround and response time of short and long jobs apart ([0] short,
+// [1] long), next to the table's histograms for all jobs
+struct MlfqLatency {
+    latency_hist turnaround[2];
+    latency_hist response[2];
+};
+
+static int parseQuanta(const char *list, struct Mlfq *m) {
+    m->levels = 0;
+    while (*list) {
+        char *end;
+        long q = strtol(list, &end, 10);
+        if (end == list || q <= 0 || q > INT_MAX || m->levels == MLFQ_MAX_LEVELS) return 0;
+        m->quantum[m->levels++] = (int)q;
+        list = (*end == ',') ? end + 1 : end;
+        if (*end != ',' && *end != '\0') return 0;
+    }
+    return m->levels > 0;
+}
+
+int main(int argc, char *argv[]) {
+    struct Mlfq m;
+    int boostInterval = MLFQ_DEFAULT_BOOST;
+    long long shortThreshold = -1;
+    const char *path = NULL;
+
+    m.levels = (int)(sizeof(defaultQuanta) / sizeof(defaultQuanta[0]));
+    memcpy(m.quantum, defaultQuanta, sizeof(defaultQuanta));
+    int ok = 1;
+    for (int i = 1; i < argc && ok; i++) {
+        if (strcmp(argv[i], "--quanta") == 0 && i + 1 < argc) ok = parseQuanta(argv[++i], &m);
+        else if (strcmp(argv[i], "--boost") == 0 && i + 1 < argc) boostInterval = (int)strtol(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--short") == 0 && i + 1 < argc) shortThreshold = strtoll(argv[++i], NULL, 10);
+        else if (path == NULL && argv[i][0] != '-') path = argv[i];
+        else ok = 0;
+    }
+    if (!ok || path == NULL || boostInterval < 0) {
+        printf("Usage: %s TRACE_FILE [--quanta Q0,Q1,...] [--boost TICKS] [--short TICKS]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (shortThreshold < 0) {
+        shortThreshold = 0;
+        for (int l = 0; l + 1 < m.levels; l++) shortThreshold += m.quantum[l];
+    }
+
+    process_table pt;
+    pt_latency latency;
+    struct MlfqLatency split;
+    pt_init(&pt, 1 << 16);
+    pt_attach_latency(&pt, &latency);
+    pt_load(&pt, path, 1);
+    int n = pt.count;
+    if (n == 0) {
+        printf("No jobs in the trace\n");
+        pt_free(&pt);
+        return EXIT_FAILURE;
+    }
+
+    struct MlfqStats st;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    runMlfq(&m, &pt, boostInterval, &st);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("MLFQ Scheduling Results for %s:\n", path);
+    printf("Levels: %d, quanta:", m.levels);
+    for (int l = 0; l < m.levels; l++) printf(" %d", m.quantum[l]);
+    if (boostInterval > 0) printf(", boost every %d ticks\n", boostInterval);
+    else printf(", no boost\n");
+    printf("Jobs: %d (short: burst <= %lld)\n", n, shortThreshold);
+    printf("Dispatches: %ld, preemptions: %ld, demotions: %ld, boosts: %ld, idle time: %lld\n",
+           st.dispatches, st.preemptions, st.demotions, st.boosts, st.idleTime);
+    printf("Finished at level:");
+    for (int l = 0; l < m.levels; l++) printf(" %ld", st.finishedAt[l]);
+    printf("\n");
+
+    // Percentiles of turnaround and response time, short and long jobs apart
+    memset(&split, 0, sizeof(split));
+    for (int i = 0; i < n; i++) {
+        int isLong = pt.burst[i] > shortThreshold;
+        latency_hist_record(&split.turnaround[isLong], pt.turnaround[i]);
+        latency_hist_record(&split.response[isLong], pt.start[i] - pt.arrival[i]);
+    }
+    printf("\n");
+    latency_hist_print_header("Percentiles");
+    latency_hist_print("Turnaround, short", &split.turnaround[0]);
+    latency_hist_print("Turnaround, long", &split.turnaround[1]);
+    latency_hist_print("Response, short", &split.response[0]);
+    latency_hist_print("Response, long", &split.response[1]);
+    printf("\n");
+    pt_print_latency(&latency);
+
+    pt_summary wait = pt_summarize(pt.wait, n);
+    pt_summary turnaround = pt_summarize(pt.turnaround, n);
+    printf("\n");
+    pt_print_summary("Waiting time", &wait);
+    pt_print_summary("Turnaround time", &turnaround);
+    printf("\nSimulation time: %.3f s\n", seconds);
+
+    pt_free(&pt);
+    return 0;
+}
@@ -0,0 +1,76 @@
+#ifndef PRIO_ARRAY_H
+#define PRIO_ARRAY_H
+
+// Priority array in the style of the Linux O(1) scheduler: one FIFO per
+// priority level, plus a bitmap with bit p set while level p is non-empty.
+// The best (lowest numbered) non-empty level is one find-first-set
+// instruction away, so enqueue, pick and dequeue-head are O(1) however many
+// tasks are queued.
+//
+// Items are task indices. The FIFOs are singly linked through one next[]
+// array shared by all levels, so each task can be on at most one level.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define PRIO_LEVELS 64      // one bitmap word
+
+typedef struct {
+    uint64_t bitmap;
+    int head[PRIO_LEVELS];
+    int tail[PRIO_LEVELS];
+    int *next;
+    int nr_queued;
+} prio_array;
+
+static inline void prio_array_init(prio_array *pa, int capacity) {
+    pa->next = (int *)malloc((capacity > 0 ? capacity : 1) * sizeof(int));
+    if (pa->next == NULL) {
+        printf("Out of memory for a priority array of %d\n", capacity);
+        exit(EXIT_FAILURE);
+    }
+    pa->bitmap = 0;
+    pa->nr_queued = 0;
+    for (int p = 0; p < PRIO_LEVELS; p++) pa->head[p] = pa->tail[p] = -1;
+}
+
+static inline void prio_array_free(prio_array *pa) {
+    free(pa->next);
+    pa->next = NULL;
+}
+
+static inline int prio_array_empty(const prio_array *pa) {
+    return pa->bitmap == 0;
+}
+
+// Best non-empty level (find-first-set); the array must not be empty
+static inline int prio_first_level(const prio_array *pa) {
+    return __builtin_ctzll(pa->bitmap);
+}
+
+static inline int prio_peek(const prio_array *pa, int level) {
+    return pa->head[level];
+}
+
+static inline void prio_enqueue(prio_array *pa, int item, int level) {
+    pa->next[item] = -1;
+    if (pa->tail[level] < 0) pa->head[level] = item;
+    else pa->next[pa->tail[level]] = item;
+    pa->tail[level] = item;
+    pa->bitmap |= 1ULL << level;
+    pa->nr_queued++;
+}
+
+static inline int prio_dequeue_head(prio_array *pa, int level) {
+    int item = pa->head[level];
+    pa->head[level] = pa->next[item];
+    if (pa->head[level] < 0) {
+        pa->tail[level] = -1;
+        pa->bitmap &= ~(1ULL << level);
+    }
+    pa->nr_queued--;
+    return item;
+}
+
+#endif
@@ -1,74 +1,355 @@
 // Non-preemptive priority scheduling (lower priority value = higher priority)
+// ./priority --preemptive: preemptive priority scheduling with arrivals and aging
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include "prio_array.h"
+#include "process_table.h"
 
-// Single process entry
-struct Process {
-    int id;
-    int burstTime;
-    int priority;
-    int waitingTime;
-    int turnaroundTime;
+struct PriorityStats {
+    long decisions;             // picks of the next task
+    long preemptions;
+    long agingBoosts;           // times a waiting task rose one level
+    long long idleTime;
 };
 
-int main() {
-    int n, i, j;
-    struct Process temp;
-    float avgWait = 0, avgTurnaround = 0;
+// Aging: a task that has waited agingInterval ticks at one level rises to
+// the next better level, and starts waiting there. Each level's FIFO is in
+// order of levelSince, so only its head can be due. Level 0 cannot rise.
+static void applyAging(prio_array *pa, int *level, long long *levelSince, long long now,
+                       int agingInterval, struct PriorityStats *st) {
+    uint64_t levels = pa->bitmap & ~1ULL;
+    while (levels) {
+        int l = __builtin_ctzll(levels);
+        levels &= levels - 1;
+        while (prio_peek(pa, l) >= 0 && levelSince[prio_peek(pa, l)] + agingInterval <= now) {
+            int i = prio_dequeue_head(pa, l);
+            level[i] = l - 1;
+            levelSince[i] = now;
+            prio_enqueue(pa, i, l - 1);
+            st->agingBoosts++;
+        }
+    }
+}
 
-    printf("Enter the number of processes: ");
-    scanf("%d", &n);
+static long long nextAgingDue(const prio_array *pa, const long long *levelSince, int agingInterval) {
+    long long due = LLONG_MAX;
+    uint64_t levels = pa->bitmap & ~1ULL;
+    while (levels) {
+        int l = __builtin_ctzll(levels);
+        levels &= levels - 1;
+        long long d = levelSince[prio_peek(pa, l)] + agingInterval;
+        if (d < due) due = d;
+    }
+    return due;
+}
 
-    struct Process p[n];
+// Event-driven preemptive priority scheduling. Time only moves to the next
+// arrival, completion or aging event. A task runs at the level it was
+// picked from, and is preempted as soon as a better level is non-empty;
+// it then goes to the back of its base priority's FIFO, and its aging
+// starts over. Every decision is a find-first-set on the bitmap, so its
+// cost does not depend on the number of tasks. The table's priority column
+// is the base priority, 0 (highest) .. PRIO_LEVELS-1; the table ends up
+// sorted by arrival.
+static void runPreemptive(process_table *pt, int agingInterval, struct PriorityStats *st) {
+    int n = pt->count;
+    const int *arrival = pt->arrival;
+    int *remaining = pt->remaining;
+    prio_array pa;
+    long long now = 0;
+    int completed = 0;
+    int next = 0;               // next task to arrive
+    int running = -1;
 
-    printf("\nEnter process details:\n");
-    for(i = 0; i < n; i++) {
-        p[i].id = i + 1;
-        printf("P%d burst time: ", i + 1);
-        scanf("%d", &p[i].burstTime);
-        printf("P%d priority (lower = higher): ", i + 1);
-        scanf("%d", &p[i].priority);
+    memset(st, 0, sizeof(*st));
+    pt_sort_by(pt, pt->arrival);
+    int *level = malloc(n * sizeof(int));                   // level it is queued or running at
+    long long *levelSince = malloc(n * sizeof(long long));  // when it joined that level
+    if (level == NULL || levelSince == NULL) {
+        printf("Out of memory for %d tasks\n", n);
+        exit(EXIT_FAILURE);
     }
+    prio_array_init(&pa, n);
 
-    // sort by priority (ascending)
-    for(i = 0; i < n - 1; i++) {
-        for(j = 0; j < n - i - 1; j++) {
-            if(p[j].priority > p[j+1].priority) {
-                temp = p[j];
-                p[j] = p[j+1];
-                p[j+1] = temp;
+    while (completed < n) {
+        // Idle CPU: jump to the next arrival
+        if (running < 0 && prio_array_empty(&pa) && now < arrival[next]) {
+            st->idleTime += arrival[next] - now;
+            now = arrival[next];
+        }
+        while (next < n && arrival[next] <= now) {
+            level[next] = pt->priority[next];
+            levelSince[next] = now;
+            prio_enqueue(&pa, next, level[next]);
+            next++;
+        }
+        if (agingInterval > 0) applyAging(&pa, level, levelSince, now, agingInterval, st);
+
+        if (running >= 0 && !prio_array_empty(&pa) && prio_first_level(&pa) < level[running]) {
+            level[running] = pt->priority[running];
+            levelSince[running] = now;
+            prio_enqueue(&pa, running, level[running]);
+            running = -1;
+            st->preemptions++;
+        }
+        if (running < 0) {
+            running = prio_dequeue_head(&pa, prio_first_level(&pa));
+            st->decisions++;
+            if (pt->start[running] < 0) pt->start[running] = now;
+        }
+
+        // Run until the next event
+        long long until = now + remaining[running];
+        if (next < n && arrival[next] < until) until = arrival[next];
+        if (agingInterval > 0) {
+            long long due = nextAgingDue(&pa, levelSince, agingInterval);
+            if (due < until) until = due;
+        }
+        remaining[running] -= (int)(until - now);
+        now = until;
+
+        if (remaining[running] == 0) {
+            pt_finish(pt, running, now);
+            completed++;
+            running = -1;
+        }
+    }
+    prio_array_free(&pa);
+    free(level);
+    free(levelSince);
+}
+
+// Waiting time, response time and the worst of each per priority class
+// (base priority): the starvation picture
+static void printClassReport(const process_table *pt, const long long *responseTimes) {
+    long count[PRIO_LEVELS] = {0};
+    long long totalWait[PRIO_LEVELS] = {0}, maxWait[PRIO_LEVELS] = {0}, maxResponse[PRIO_LEVELS] = {0};
+    for (int i = 0; i < pt->count; i++) {
+        int c = pt->priority[i];
+        long long wait = pt->wait[i];
+        long long response = responseTimes[i];
+        count[c]++;
+        totalWait[c] += wait;
+        if (wait > maxWait[c]) maxWait[c] = wait;
+        if (response > maxResponse[c]) maxResponse[c] = response;
+    }
+    printf("\nPrio\tTasks\tAvg wait\tMax wait\tMax response\n");
+    for (int c = 0; c < PRIO_LEVELS; c++)
+        if (count[c] > 0)
+            printf("%d\t%ld\t%.2f\t\t%lld\t\t%lld\n", c, count[c], (double)totalWait[c] / count[c],
+                   maxWait[c], maxResponse[c]);
+}
+
+static int validTask(int burst, int priority) {
+    return burst >= 0 && priority >= 0 && priority < PRIO_LEVELS;
+}
+
+// Usage: ./priority --preemptive [TRACE_FILE] [--aging TICKS] [--summary]
+// Tasks are entered by hand or read from "arrival burst priority" lines.
+static int preemptiveMain(int argc, char *argv[]) {
+    const char *path = NULL;
+    int agingInterval = 0, summary = 0, n = 0;
+    process_table pt;
+    pt_latency latency;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--aging") == 0 && i + 1 < argc) agingInterval = (int)strtol(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--summary") == 0) summary = 1;
+        else if (path == NULL && argv[i][0] != '-') path = argv[i];
+        else {
+            printf("Usage: %s --preemptive [TRACE_FILE] [--aging TICKS] [--summary]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (path != NULL) {
+        workload_reader r;
+        int arrival, burst, priority;
+        pt_init(&pt, 1024);
+        pt_attach_latency(&pt, &latency);
+        workload_open(&r, path);
+        while (workload_next(&r, &arrival, &burst, &priority)) {
+            if (!validTask(burst, priority))
+                workload_error(&r, "need a burst >= 0 and a priority from 0 to 63");
+            pt_add(&pt, arrival, burst, priority);
+        }
+        workload_close(&r);
+        n = pt.count;
+        if (n == 0) {
+            printf("No processes in the trace\n");
+            pt_free(&pt);
+            return EXIT_FAILURE;
+        }
+    } else {
+        printf("Enter the number of processes: ");
+        if (scanf("%d", &n) != 1 || n <= 0) {
+            printf("\nThe number of processes must be positive\n");
+            return EXIT_FAILURE;
+        }
+        pt_init(&pt, n);
+        pt_attach_latency(&pt, &latency);
+        printf("\nEnter process details:\n");
+        for (int i = 0; i < n; i++) {
+            int arrival = 0, burst = 0, priority = 0;
+            printf("P%d arrival time: ", i + 1);
+            scanf("%d", &arrival);
+            printf("P%d burst time: ", i + 1);
+            scanf("%d", &burst);
+            printf("P%d priority (0-63, lower = higher): ", i + 1);
+            scanf("%d", &priority);
+            if (!validTask(burst, priority)) {
+                printf("\nNeed a burst >= 0 and a priority from 0 to 63\n");
+                pt_free(&pt);
+                return EXIT_FAILURE;
             }
+            pt_add(&pt, arrival, burst, priority);
         }
     }
 
-    // first process has zero waiting time
-    p[0].waitingTime = 0;
-    p[0].turnaroundTime = p[0].waitingTime + p[0].burstTime;
+    struct PriorityStats st;
+    runPreemptive(&pt, agingInterval, &st);
 
-    // waiting time of each process = turnaround of previous
-    for(i = 1; i < n; i++) {
-        p[i].waitingTime = p[i-1].turnaroundTime;
-        p[i].turnaroundTime = p[i].waitingTime + p[i].burstTime;
+    long long *response = malloc(n * sizeof(long long));
+    if (response == NULL) {
+        printf("Out of memory for %d processes\n", n);
+        pt_free(&pt);
+        return EXIT_FAILURE;
     }
+    pt_response_times(&pt, response);
 
-    int totalWait = 0;
-    int totalTurnaround = 0;
+    printf("\nPreemptive priority scheduling results (aging %s):\n",
+           agingInterval > 0 ? "on" : "off");
+    if (agingInterval > 0) printf("A waiting task rises one level every %d ticks\n", agingInterval);
+    if (!summary) {
+        printf("PID\tArrival\tPrio\tBurst\tWait\tResponse\tTurnaround\n");
+        for (int i = 0; i < n; i++)
+            printf("P%d\t%d\t%d\t%d\t%lld\t%lld\t\t%lld\n", pt.id[i], pt.arrival[i], pt.priority[i],
+                   pt.burst[i], pt.wait[i], response[i], pt.turnaround[i]);
+    }
+    printClassReport(&pt, response);
+
+    pt_summary wait = pt_summarize(pt.wait, n);
+    pt_summary resp = pt_summarize(response, n);
+    pt_summary turnaround = pt_summarize(pt.turnaround, n);
+    printf("\nDecisions: %ld, preemptions: %ld, aging boosts: %ld, idle time: %lld\n",
+           st.decisions, st.preemptions, st.agingBoosts, st.idleTime);
+    printf("Average waiting time: %.2f\n", (float)wait.sum / n);
+    printf("Average turnaround time: %.2f\n", (float)turnaround.sum / n);
+    pt_print_summary("Waiting time", &wait);
+    pt_print_summary("Response time", &resp);
+    pt_print_summary("Turnaround time", &turnaround);
+    printf("\n");
+    pt_print_latency(&latency);
+    free(response);
+    pt_free(&pt);
+    return 0;
+}
+
+// Usage: ./priority --bench [--aging TICKS]
+// Runs the preemptive engine on random workloads of growing size (bursts
+// 1-20, priorities 0-63, arrivals keeping the CPU ~95% busy) to show the
+// cost per decision stays flat as n grows.
+static int benchMain(int argc, char *argv[]) {
+    int agingInterval = 0;
+    if (argc == 4 && strcmp(argv[2], "--aging") == 0) agingInterval = (int)strtol(argv[3], NULL, 10);
+    else if (argc != 2) {
+        printf("Usage: %s --bench [--aging TICKS]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("Preemptive priority benchmark, aging %s\n", agingInterval > 0 ? "on" : "off");
+    printf("Tasks\t\tDecisions\tPreemptions\tTime(s)\tns/decision\tp99 wait\tWorst wait\n");
+    pt_latency latency;
+    for (int n = 1000; n <= 1000000; n *= 10) {
+        process_table pt;
+        pt_init(&pt, n);
+        pt_attach_latency(&pt, &latency);
+        srand(42);
+        for (int i = 0; i < n; i++) {
+            int priority = rand() % PRIO_LEVELS;
+            int burst = 1 + rand() % 20;
+            pt_add(&pt, rand() % (11 * n), burst, priority);
+        }
+        // Sort outside the timed run, which then only checks the order
+        pt_sort_by(&pt, pt.arrival);
+
+        struct PriorityStats st;
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        runPreemptive(&pt, agingInterval, &st);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+        printf("%d\t\t%ld\t\t%ld\t\t%.3f\t%.1f\t\t%lld\t\t%lld\n", n, st.decisions,
+               st.preemptions, seconds, seconds * 1e9 / st.decisions,
+               latency_hist_percentile(&latency.wait, 0.99), latency.wait.max);
+        pt_free(&pt);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int n, i, burst, priority;
+    process_table pt;
+    pt_latency latency;
+
+    if (argc > 1 && strcmp(argv[1], "--preemptive") == 0) return preemptiveMain(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) return benchMain(argc, argv);
+    if (argc > 1) {
+        printf("Usage: %s [--preemptive [TRACE_FILE] [--aging TICKS] [--summary] | --bench [--aging TICKS]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("Enter the number of processes: ");
+    if (scanf("%d", &n) != 1 || n <= 0) {
+        printf("\nThe number of processes must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    pt_init(&pt, n);
+    pt_attach_latency(&pt, &latency);
+
+    printf("\nEnter process details:\n");
+    for(i = 0; i < n; i++) {
+        printf("P%d burst time: ", i + 1);
+        scanf("%d", &burst);
+        printf("P%d priority (lower = higher): ", i + 1);
+        scanf("%d", &priority);
+        pt_add(&pt, 0, burst, priority);
+    }
+
+    // sort by priority (ascending), keeping input order within a priority
+    pt_sort_by(&pt, pt.priority);
+
+    // everyone arrives at 0: each process completes when the previous
+    // one has, plus its own burst
+    long long completion = 0;
+    for(i = 0; i < n; i++) {
+        completion += pt.burst[i];
+        pt_finish(&pt, i, completion);
+    }
 
     printf("\nPriority scheduling results:\n");
     printf("PID\tPrio\tBurst\tWait\tTurnaround\n");
 
     for(i = 0; i < n; i++) {
-        totalWait += p[i].waitingTime;
-        totalTurnaround += p[i].turnaroundTime;
-        
-         printf("P%d\t%d\t%d\t%d\t%d\n", 
-             p[i].id, p[i].priority, p[i].burstTime, p[i].waitingTime, p[i].turnaroundTime);
+        printf("P%d\t%d\t%d\t%lld\t%lld\n",
+               pt.id[i], pt.priority[i], pt.burst[i], pt.wait[i], pt.turnaround[i]);
     }
 
-    avgWait = (float)totalWait / n;
-    avgTurnaround = (float)totalTurnaround / n;
+    pt_summary wait = pt_summarize(pt.wait, n);
+    pt_summary turnaround = pt_summarize(pt.turnaround, n);
 
-    printf("\nAverage waiting time: %.2f\n", avgWait);
-    printf("Average turnaround time: %.2f\n", avgTurnaround);
+    printf("\nAverage waiting time: %.2f\n", (float)wait.sum / n);
+    printf("Average turnaround time: %.2f\n", (float)turnaround.sum / n);
+    pt_print_summary("Waiting time", &wait);
+    pt_print_summary("Turnaround time", &turnaround);
+    printf("\n");
+    pt_print_latency(&latency);
 
+    pt_free(&pt);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,316 @@
+#ifndef PROCESS_TABLE_H
+#define PROCESS_TABLE_H
+
+// Structure-of-arrays process table shared by the classic schedulers
+// (Fcfs.c, Sjf.c, Round_robin.c, priority.c, mlfq.c, proportional.c). Every
+// field is its own contiguous array indexed by process, so a pass over one
+// field streams only that field, and the statistics at the end are simple
+// loops over one array that the compiler vectorizes (build with -O3, or -O2
+// -ftree-vectorize).
+// Times that grow with the trace (start, wait, turnaround) are 64-bit.
+// A table with latency histograms attached records every completion into
+// them as it happens (see pt_finish), for tail percentiles without a pass
+// over the columns or any allocation in the scheduling loop.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "workload_file.h"
+#include "latency_hist.h"
+
+// Per-run latency distributions, filled in by pt_finish
+typedef struct {
+    latency_hist wait;
+    latency_hist turnaround;
+    latency_hist response;  // processes with a start time only
+} pt_latency;
+
+typedef struct {
+    int count;
+    int capacity;
+    int *id;                // 1-based input order
+    int *arrival;
+    int *burst;
+    int *priority;
+    int *remaining;
+    long long *start;       // first time on the CPU, -1 before that
+    long long *wait;        // turnaround - burst
+    long long *turnaround;  // completion - arrival
+    pt_latency *latency;    // NULL: no histograms
+} process_table;
+
+static inline void *pt_grow_column(void *column, int capacity, size_t size) {
+    void *grown = realloc(column, (size_t)capacity * size);
+    if (grown == NULL) {
+        printf("Out of memory for %d processes\n", capacity);
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+static inline void pt_reserve(process_table *pt, int capacity) {
+    if (capacity <= pt->capacity) return;
+    pt->id = (int *)pt_grow_column(pt->id, capacity, sizeof(int));
+    pt->arrival = (int *)pt_grow_column(pt->arrival, capacity, sizeof(int));
+    pt->burst = (int *)pt_grow_column(pt->burst, capacity, sizeof(int));
+    pt->priority = (int *)pt_grow_column(pt->priority, capacity, sizeof(int));
+    pt->remaining = (int *)pt_grow_column(pt->remaining, capacity, sizeof(int));
+    pt->start = (long long *)pt_grow_column(pt->start, capacity, sizeof(long long));
+    pt->wait = (long long *)pt_grow_column(pt->wait, capacity, sizeof(long long));
+    pt->turnaround = (long long *)pt_grow_column(pt->turnaround, capacity, sizeof(long long));
+    pt->capacity = capacity;
+}
+
+static inline void pt_init(process_table *pt, int capacity) {
+    memset(pt, 0, sizeof(*pt));
+    pt_reserve(pt, capacity > 0 ? capacity : 1);
+}
+
+static inline void pt_free(process_table *pt) {
+    free(pt->id);
+    free(pt->arrival);
+    free(pt->burst);
+    free(pt->priority);
+    free(pt->remaining);
+    free(pt->start);
+    free(pt->wait);
+    free(pt->turnaround);
+    memset(pt, 0, sizeof(*pt));
+}
+
+// Append a process; its id is its 1-based position. Returns its index.
+static inline int pt_add(process_table *pt, int arrival, int burst, int priority) {
+    if (pt->count == pt->capacity) pt_reserve(pt, 2 * pt->capacity);
+    int i = pt->count++;
+    pt->id[i] = i + 1;
+    pt->arrival[i] = arrival;
+    pt->burst[i] = burst;
+    pt->priority[i] = priority;
+    pt->remaining[i] = burst;
+    pt->start[i] = -1;
+    pt->wait[i] = 0;
+    pt->turnaround[i] = 0;
+    return i;
+}
+
+// Record this table's completions into l, starting from empty. l belongs
+// to the caller and must outlive the runs.
+static inline void pt_attach_latency(process_table *pt, pt_latency *l) {
+    memset(l, 0, sizeof(*l));
+    pt->latency = l;
+}
+
+// Load every "arrival burst [priority]" line of a trace file; bursts below
+// min_burst (0 or 1) are an error
+static inline void pt_load(process_table *pt, const char *path, int min_burst) {
+    workload_reader r;
+    int arrival, burst, priority;
+    workload_open(&r, path);
+    while (workload_next(&r, &arrival, &burst, &priority)) {
+        if (burst < min_burst)
+            workload_error(&r, min_burst > 0 ? "burst time must be positive"
+                                            : "burst time must not be negative");
+        pt_add(pt, arrival, burst, priority);
+    }
+    workload_close(&r);
+}
+
+// Clear the per-run columns (remaining, start, wait, turnaround) and the
+// histograms for a fresh run over the same processes
+static inline void pt_reset_run(process_table *pt) {
+    memcpy(pt->remaining, pt->burst, (size_t)pt->count * sizeof(int));
+    for (int i = 0; i < pt->count; i++) {
+        pt->start[i] = -1;
+        pt->wait[i] = 0;
+        pt->turnaround[i] = 0;
+    }
+    if (pt->latency != NULL) {
+        latency_hist_reset(&pt->latency->wait);
+        latency_hist_reset(&pt->latency->turnaround);
+        latency_hist_reset(&pt->latency->response);
+    }
+}
+
+// A table for one more run over the same processes: it shares the input
+// columns (id, arrival, burst, priority) of shared, read-only, and has its
+// own per-run columns, so runs on different threads do not interfere.
+// It starts without histograms; attach its own, never shared's.
+// Free it with pt_fork_free, never pt_free or pt_add.
+static inline void pt_fork(process_table *run, const process_table *shared) {
+    *run = *shared;
+    run->capacity = shared->count;
+    run->latency = NULL;
+    run->remaining = (int *)pt_grow_column(NULL, run->count > 0 ? run->count : 1, sizeof(int));
+    run->start = (long long *)pt_grow_column(NULL, run->count > 0 ? run->count : 1, sizeof(long long));
+    run->wait = (long long *)pt_grow_column(NULL, run->count > 0 ? run->count : 1, sizeof(long long));
+    run->turnaround = (long long *)pt_grow_column(NULL, run->count > 0 ? run->count : 1, sizeof(long long));
+    pt_reset_run(run);
+}
+
+static inline void pt_fork_free(process_table *run) {
+    free(run->remaining);
+    free(run->start);
+    free(run->wait);
+    free(run->turnaround);
+    memset(run, 0, sizeof(*run));
+}
+
+// Process i completed at the given time: fill in its turnaround and wait,
+// and record them (and its response time, if it has a start) when
+// histograms are attached
+static inline void pt_finish(process_table *pt, int i, long long completion) {
+    pt->turnaround[i] = completion - pt->arrival[i];
+    pt->wait[i] = pt->turnaround[i] - pt->burst[i];
+    if (pt->latency != NULL) {
+        latency_hist_record(&pt->latency->wait, pt->wait[i]);
+        latency_hist_record(&pt->latency->turnaround, pt->turnaround[i]);
+        if (pt->start[i] >= 0)
+            latency_hist_record(&pt->latency->response, pt->start[i] - pt->arrival[i]);
+    }
+}
+
+// Response time (first run - arrival) of every process, into out[count]
+static inline void pt_response_times(const process_table *pt, long long *out) {
+    for (int i = 0; i < pt->count; i++) out[i] = pt->start[i] - pt->arrival[i];
+}
+
+static inline int pt_sorted_by(const process_table *pt, const int *key) {
+    for (int i = 1; i < pt->count; i++)
+        if (key[i - 1] > key[i]) return 0;
+    return 1;
+}
+
+// Stable sort of the table by one of its input columns (pt->arrival,
+// pt->burst or pt->priority), so equal keys keep their input order. Meant
+// for before a run: remaining, start, wait and turnaround are reset rather
+// than permuted. LSD radix sort of (key, index) pairs, 8 bits per pass,
+// skipping passes where every key has the same byte; the key column is then
+// rebuilt from the sorted keys and only the other input columns are
+// gathered. An already sorted table is left alone.
+static inline void pt_sort_by(process_table *pt, int *key) {
+    int n = pt->count;
+    if (pt_sorted_by(pt, key)) return;
+
+    uint64_t *order = (uint64_t *)malloc((size_t)n * sizeof(uint64_t));
+    uint64_t *tmp = (uint64_t *)malloc((size_t)n * sizeof(uint64_t));
+    if (order == NULL || tmp == NULL) {
+        printf("Out of memory sorting %d processes\n", n);
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < n; i++)
+        order[i] = ((uint64_t)((uint32_t)key[i] ^ 0x80000000u) << 32) | (uint32_t)i;
+
+    for (int shift = 32; shift < 64; shift += 8) {
+        long count[257] = {0};
+        for (int i = 0; i < n; i++) count[((order[i] >> shift) & 0xFF) + 1]++;
+
+        int trivial = 0;
+        for (int b = 1; b <= 256; b++)
+            if (count[b] == n) trivial = 1;
+        if (trivial) continue;
+
+        for (int b = 0; b < 256; b++) count[b + 1] += count[b];
+        for (int i = 0; i < n; i++) tmp[count[(order[i] >> shift) & 0xFF]++] = order[i];
+        uint64_t *swap = order;
+        order = tmp;
+        tmp = swap;
+    }
+
+    // tmp is scratch space from here on
+    int *gathered = (int *)tmp;
+    int *inputs[4] = {pt->id, pt->arrival, pt->burst, pt->priority};
+    for (int c = 0; c < 4; c++) {
+        if (inputs[c] == key) continue;
+        for (int i = 0; i < n; i++) gathered[i] = inputs[c][(uint32_t)order[i]];
+        memcpy(inputs[c], gathered, (size_t)n * sizeof(int));
+    }
+    for (int i = 0; i < n; i++) key[i] = (int)((uint32_t)(order[i] >> 32) ^ 0x80000000u);
+    pt_reset_run(pt);
+    free(order);
+    free(tmp);
+}
+
+typedef struct {
+    long count;
+    long long sum;
+    long long min;
+    long long max;
+    double mean;
+    double variance;        // population variance
+} pt_summary;
+
+// Sum, min, max and variance of one column, in two passes that vectorize.
+// The first is a plain 64-bit reduction (with SSE4.2 or AVX2 for the 64-bit
+// compares, e.g. -O3 -march=native). The second keeps four independent
+// partial sums of the squared deviations, so no single floating-point sum
+// has to be reassociated, and converts to double by adding the exponent
+// bias of 1.5 * 2^52 and reinterpreting the bits: exact for |x| < 2^51,
+// which the min and max confirm, and unlike a cast it has a SIMD form below
+// AVX-512.
+static inline pt_summary pt_summarize(const long long *x, int n) {
+    pt_summary s = {n, 0, 0, 0, 0.0, 0.0};
+    if (n <= 0) return s;
+
+    long long sum = 0, min = x[0], max = x[0];
+    for (int i = 0; i < n; i++) {
+        long long v = x[i];
+        sum += v;
+        min = v < min ? v : min;
+        max = v > max ? v : max;
+    }
+    s.sum = sum;
+    s.min = min;
+    s.max = max;
+    s.mean = (double)sum / n;
+
+    const long long limit = 1LL << 51;
+    double acc[4] = {0.0, 0.0, 0.0, 0.0};
+    int i = 0;
+    if (min > -limit && max < limit) {
+        for (; i + 4 <= n; i += 4)
+            for (int k = 0; k < 4; k++) {
+                uint64_t bits = (uint64_t)x[i + k] + 0x4338000000000000ULL;
+                double v;
+                memcpy(&v, &bits, sizeof(v));
+                double d = (v - 6755399441055744.0) - s.mean;
+                acc[k] += d * d;
+            }
+    }
+    for (; i < n; i++) {
+        double d = (double)x[i] - s.mean;
+        acc[0] += d * d;
+    }
+    s.variance = (acc[0] + acc[1] + acc[2] + acc[3]) / n;
+    return s;
+}
+
+// Add one value to a summary kept as the values go by, for a run that
+// never stores the column; start from a zeroed pt_summary. The mean and
+// variance are updated in Welford's way, so they agree with pt_summarize
+// up to rounding.
+static inline void pt_summary_add(pt_summary *s, long long v) {
+    if (s->count == 0 || v < s->min) s->min = v;
+    if (s->count == 0 || v > s->max) s->max = v;
+    s->count++;
+    s->sum += v;
+    double delta = (double)v - s->mean;
+    s->mean += delta / s->count;
+    s->variance += (delta * ((double)v - s->mean) - s->variance) / s->count;
+}
+
+static inline void pt_print_summary(const char *label, const pt_summary *s) {
+    printf("%s: total %lld, min %lld, max %lld, mean %.2f, variance %.2f\n", label, s->sum,
+           s->min, s->max, s->mean, s->variance);
+}
+
+// Percentile table of the attached histograms; the response row only when
+// the scheduler records start times
+static inline void pt_print_latency(const pt_latency *l) {
+    latency_hist_print_header("Percentiles");
+    latency_hist_print("Waiting time", &l->wait);
+    if (l->response.total > 0) latency_hist_print("Response time", &l->response);
+    latency_hist_print("Turnaround time", &l->turnaround);
+}
+
+#endif
@@ -0,0 +1,358 @@
+// Proportional-share scheduling: stride (deterministic) and lottery (randomized)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "process_table.h"
+
+// Usage: ./proportional TRACE_FILE [--lottery] [--quantum Q] [--seed S] [--summary]
+//        ./proportional --bench [--quantum Q] [--seed S]
+//
+// TRACE_FILE holds "arrival burst [tickets]" lines (see workload_file.h):
+// the third column, a priority for the other schedulers, is the task's
+// ticket count here, and 0 or missing means DEFAULT_TICKETS. Each runnable
+// task should get a share of the CPU in proportion to its tickets. Stride
+// scheduling (the default) runs the task with the lowest pass and then
+// advances its pass by its stride, STRIDE1 / tickets. Lottery scheduling
+// draws a random ticket. Either way a decision runs one quantum (or what
+// is left of the burst). --summary skips the per-process table.
+//
+// Fairness is measured against the ideal fluid schedule, where every
+// runnable task receives tickets / total of every tick. A task's lag is
+// the CPU time it should have had by now, minus what it has had.
+//
+// --bench runs both engines on 10^5 to 10^6 tasks that all arrive at 0
+// and reports decisions per second and share error.
+
+#define DEFAULT_TICKETS 100
+#define STRIDE1 (1 << 20)           // stride of a one-ticket task; also the most tickets
+#define DEFAULT_SEED 1
+
+struct ShareStats {
+    long decisions;
+    long long idleTime;
+    double shareError;              // mean over tasks of |lag at exit| / burst
+    latency_hist lagAfterRun;       // |lag| of each task after it runs, in ticks
+    latency_hist lagAtExit;
+};
+
+// The ideal schedule, shared by both engines. virtualTime is the sum of
+// 1 / total tickets over every tick run, so a task that joined at virtual
+// time v should by now have received tickets * (virtualTime - v) ticks.
+struct Ideal {
+    double virtualTime;
+    double *joinedAt;
+};
+
+static long long roundedAbs(double x) {
+    return (long long)((x < 0 ? -x : x) + 0.5);
+}
+
+static double lagOf(const struct Ideal *ideal, const process_table *pt, int i) {
+    double owed = pt->priority[i] * (ideal->virtualTime - ideal->joinedAt[i]);
+    return owed - (pt->burst[i] - pt->remaining[i]);
+}
+
+// Task i ran for ran ticks out of a runnable total of totalTickets. If
+// that finished it, it completes at now.
+static void chargeRun(struct Ideal *ideal, process_table *pt, int i, int ran, long long totalTickets,
+                      long long now, struct ShareStats *st) {
+    ideal->virtualTime += (double)ran / totalTickets;
+    pt->remaining[i] -= ran;
+    double lag = lagOf(ideal, pt, i);
+    latency_hist_record(&st->lagAfterRun, roundedAbs(lag));
+    if (pt->remaining[i] == 0) {
+        pt_finish(pt, i, now);
+        latency_hist_record(&st->lagAtExit, roundedAbs(lag));
+        st->shareError += (lag < 0 ? -lag : lag) / pt->burst[i];
+    }
+}
+
+// Binary min-heap of (pass, task), ties to the earlier task
+struct PassItem {
+    uint64_t pass;
+    int task;
+};
+
+struct PassHeap {
+    struct PassItem *items;
+    int size;
+};
+
+static int passBefore(struct PassItem a, struct PassItem b) {
+    return a.pass < b.pass || (a.pass == b.pass && a.task < b.task);
+}
+
+static void passPush(struct PassHeap *h, uint64_t pass, int task) {
+    struct PassItem item = {pass, task};
+    int i = h->size++;
+    while (i > 0 && passBefore(item, h->items[(i - 1) / 2])) {
+        h->items[i] = h->items[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    h->items[i] = item;
+}
+
+static struct PassItem passPop(struct PassHeap *h) {
+    struct PassItem top = h->items[0];
+    struct PassItem last = h->items[--h->size];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= h->size) break;
+        if (child + 1 < h->size && passBefore(h->items[child + 1], h->items[child])) child++;
+        if (!passBefore(h->items[child], last)) break;
+        h->items[i] = h->items[child];
+        i = child;
+    }
+    if (h->size > 0) h->items[i] = last;
+    return top;
+}
+
+// Stride scheduling. The global pass advances by STRIDE1 / total tickets
+// per tick, which makes it STRIDE1 times the ideal virtual time; a task
+// joins one quantum's stride beyond it, as if it had just had its fair
+// share. Every decision is a heap pop and push, O(log n). The table must
+// be sorted by arrival.
+static void runStride(process_table *pt, int quantum, struct ShareStats *st) {
+    int n = pt->count;
+    struct PassHeap ready = {malloc(n * sizeof(struct PassItem)), 0};
+    struct Ideal ideal = {0.0, malloc(n * sizeof(double))};
+    long long totalTickets = 0, now = 0;
+    int next = 0;               // next task to arrive
+
+    if (ready.items == NULL || ideal.joinedAt == NULL) {
+        printf("Out of memory for %d tasks\n", n);
+        exit(EXIT_FAILURE);
+    }
+    memset(st, 0, sizeof(*st));
+    pt_reset_run(pt);
+    while (next < n || ready.size > 0) {
+        if (ready.size == 0 && now < pt->arrival[next]) {
+            st->idleTime += pt->arrival[next] - now;
+            now = pt->arrival[next];
+        }
+        for (; next < n && pt->arrival[next] <= now; next++) {
+            uint64_t globalPass = (uint64_t)(ideal.virtualTime * STRIDE1);
+            totalTickets += pt->priority[next];
+            ideal.joinedAt[next] = ideal.virtualTime;
+            passPush(&ready, globalPass + (uint64_t)(STRIDE1 / pt->priority[next]) * quantum, next);
+        }
+
+        struct PassItem item = passPop(&ready);
+        int i = item.task;
+        int ran = pt->remaining[i] < quantum ? pt->remaining[i] : quantum;
+        if (pt->start[i] < 0) pt->start[i] = now;
+        now += ran;
+        st->decisions++;
+        chargeRun(&ideal, pt, i, ran, totalTickets, now, st);
+        if (pt->remaining[i] > 0) passPush(&ready, item.pass + (uint64_t)(STRIDE1 / pt->priority[i]) * ran, i);
+        else totalTickets -= pt->priority[i];
+    }
+    st->shareError /= n;
+    free(ready.items);
+    free(ideal.joinedAt);
+}
+
+// Fenwick tree over the tickets of the runnable tasks, indexed by task:
+// adding or removing a task and finding the owner of the k-th ticket are
+// both O(log n), where a list of tasks would be scanned.
+struct Fenwick {
+    long long *tree;            // 1-based
+    int size;
+    int top;                    // highest power of two <= size
+};
+
+static void fenwickInit(struct Fenwick *f, int size) {
+    f->tree = calloc(size + 1, sizeof(long long));
+    if (f->tree == NULL) {
+        printf("Out of memory for %d tasks\n", size);
+        exit(EXIT_FAILURE);
+    }
+    f->size = size;
+    for (f->top = 1; f->top * 2 <= size; f->top *= 2) ;
+}
+
+static void fenwickAdd(struct Fenwick *f, int i, long long delta) {
+    for (int k = i + 1; k <= f->size; k += k & -k) f->tree[k] += delta;
+}
+
+// The task holding ticket number k (0 <= k < total), counting the tickets
+// of the runnable tasks in index order
+static int fenwickFind(const struct Fenwick *f, long long k) {
+    int pos = 0;
+    for (int step = f->top; step > 0; step >>= 1) {
+        if (pos + step <= f->size && f->tree[pos + step] <= k) {
+            pos += step;
+            k -= f->tree[pos];
+        }
+    }
+    return pos;
+}
+
+// xorshift64*: small, fast, and the same sequence on every platform
+static uint64_t nextRandom(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+// Lottery scheduling: every decision draws one of the runnable tickets
+// uniformly and runs its owner. The table must be sorted by arrival.
+static void runLottery(process_table *pt, int quantum, uint64_t seed, struct ShareStats *st) {
+    int n = pt->count;
+    struct Fenwick tickets;
+    struct Ideal ideal = {0.0, malloc(n * sizeof(double))};
+    long long totalTickets = 0, now = 0;
+    uint64_t rng = seed ? seed : DEFAULT_SEED;
+    int next = 0, runnable = 0;
+
+    if (ideal.joinedAt == NULL) {
+        printf("Out of memory for %d tasks\n", n);
+        exit(EXIT_FAILURE);
+    }
+    memset(st, 0, sizeof(*st));
+    pt_reset_run(pt);
+    fenwickInit(&tickets, n);
+    while (next < n || runnable > 0) {
+        if (runnable == 0 && now < pt->arrival[next]) {
+            st->idleTime += pt->arrival[next] - now;
+            now = pt->arrival[next];
+        }
+        for (; next < n && pt->arrival[next] <= now; next++) {
+            fenwickAdd(&tickets, next, pt->priority[next]);
+            totalTickets += pt->priority[next];
+            ideal.joinedAt[next] = ideal.virtualTime;
+            runnable++;
+        }
+
+        // Scale a 64-bit draw to [0, totalTickets) without modulo bias worth noticing
+        long long winner = (long long)(((unsigned __int128)nextRandom(&rng) * (uint64_t)totalTickets) >> 64);
+        int i = fenwickFind(&tickets, winner);
+        int ran = pt->remaining[i] < quantum ? pt->remaining[i] : quantum;
+        if (pt->start[i] < 0) pt->start[i] = now;
+        now += ran;
+        st->decisions++;
+        chargeRun(&ideal, pt, i, ran, totalTickets, now, st);
+        if (pt->remaining[i] == 0) {
+            fenwickAdd(&tickets, i, -pt->priority[i]);
+            totalTickets -= pt->priority[i];
+            runnable--;
+        }
+    }
+    st->shareError /= n;
+    free(tickets.tree);
+    free(ideal.joinedAt);
+}
+
+static double runTimed(process_table *pt, int lottery, int quantum, uint64_t seed, struct ShareStats *st) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (lottery) runLottery(pt, quantum, seed, st);
+    else runStride(pt, quantum, st);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// Usage: ./proportional --bench [--quantum Q] [--seed S]
+static int benchMain(int quantum, uint64_t seed) {
+    static const int sizes[] = { 100000, 300000, 1000000 };
+    struct ShareStats st;
+
+    printf("Proportional share benchmark: every task arrives at 0, tickets 1-100, bursts 1-20, quantum %d\n",
+           quantum);
+    printf("Tasks\t\tEngine\tDecisions\tTime(s)\tDecisions/s\tShare error\tp99 lag\tMax lag\n");
+    for (int s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++) {
+        int n = sizes[s];
+        process_table pt;
+        pt_init(&pt, n);
+        srand(42);
+        for (int i = 0; i < n; i++) {
+            int tickets = 1 + rand() % 100;
+            pt_add(&pt, 0, 1 + rand() % 20, tickets);
+        }
+        for (int lottery = 0; lottery <= 1; lottery++) {
+            double seconds = runTimed(&pt, lottery, quantum, seed, &st);
+            printf("%d\t\t%s\t%ld\t%.3f\t%.0f\t%.3f%%\t\t%lld\t%lld\n", n, lottery ? "lottery" : "stride",
+                   st.decisions, seconds, st.decisions / seconds, 100 * st.shareError,
+                   latency_hist_percentile(&st.lagAfterRun, 0.99), st.lagAfterRun.max);
+        }
+        pt_free(&pt);
+    }
+    printf("\nLag: |ideal - received CPU time| of a task right after it runs, in ticks\n");
+    printf("Share error: mean over tasks of |lag| / burst when they finish\n");
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = NULL;
+    int lottery = 0, bench = 0, summary = 0, quantum = 1;
+    uint64_t seed = DEFAULT_SEED;
+    int ok = argc > 1;
+
+    for (int i = 1; i < argc && ok; i++) {
+        if (strcmp(argv[i], "--lottery") == 0) lottery = 1;
+        else if (strcmp(argv[i], "--bench") == 0) bench = 1;
+        else if (strcmp(argv[i], "--summary") == 0) summary = 1;
+        else if (strcmp(argv[i], "--quantum") == 0 && i + 1 < argc) ok = (quantum = (int)strtol(argv[++i], NULL, 10)) > 0;
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+        else if (path == NULL && argv[i][0] != '-') path = argv[i];
+        else ok = 0;
+    }
+    if (!ok || (path == NULL) == !bench) {
+        printf("Usage: %s TRACE_FILE [--lottery] [--quantum Q] [--seed S] [--summary]\n", argv[0]);
+        printf("       %s --bench [--quantum Q] [--seed S]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (bench) return benchMain(quantum, seed);
+
+    process_table pt;
+    pt_latency latency;
+    workload_reader r;
+    int arrival, burst, tickets;
+    pt_init(&pt, 1024);
+    pt_attach_latency(&pt, &latency);
+    workload_open(&r, path);
+    while (workload_next(&r, &arrival, &burst, &tickets)) {
+        if (burst <= 0) workload_error(&r, "burst time must be positive");
+        if (tickets < 0 || tickets > STRIDE1) workload_error(&r, "tickets must be from 0 to 1048576");
+        pt_add(&pt, arrival, burst, tickets > 0 ? tickets : DEFAULT_TICKETS);
+    }
+    workload_close(&r);
+    int n = pt.count;
+    if (n == 0) {
+        printf("No tasks in '%s'\n", path);
+        pt_free(&pt);
+        return EXIT_FAILURE;
+    }
+    pt_sort_by(&pt, pt.arrival);
+
+    struct ShareStats st;
+    double seconds = runTimed(&pt, lottery, quantum, seed, &st);
+
+    printf("%s scheduling results for %s (quantum %d):\n", lottery ? "Lottery" : "Stride", path, quantum);
+    if (!summary) {
+        printf("PID\tArrival\tBurst\tTickets\tWait\tResponse\tTurnaround\n");
+        for (int i = 0; i < n; i++)
+            printf("P%d\t%d\t%d\t%d\t%lld\t%lld\t\t%lld\n", pt.id[i], pt.arrival[i], pt.burst[i],
+                   pt.priority[i], pt.wait[i], pt.start[i] - pt.arrival[i], pt.turnaround[i]);
+    }
+
+    pt_summary wait = pt_summarize(pt.wait, n);
+    pt_summary turnaround = pt_summarize(pt.turnaround, n);
+    printf("\nTasks: %d, decisions: %ld, idle time: %lld\n", n, st.decisions, st.idleTime);
+    printf("Average waiting time: %.2f\n", (float)wait.sum / n);
+    printf("Average turnaround time: %.2f\n", (float)turnaround.sum / n);
+    pt_print_summary("Waiting time", &wait);
+    pt_print_summary("Turnaround time", &turnaround);
+    printf("Share error: %.3f%% (mean |lag| / burst at exit)\n", 100 * st.shareError);
+    printf("\n");
+    pt_print_latency(&latency);
+    latency_hist_print("Lag after a run", &st.lagAfterRun);
+    latency_hist_print("Lag at exit", &st.lagAtExit);
+    printf("\nSimulation time: %.3f s (%.0f decisions per second)\n", seconds, st.decisions / seconds);
+    pt_free(&pt);
+    return 0;
+}
@@ -0,0 +1,161 @@
+#ifndef RR_CYCLE_H
+#define RR_CYCLE_H
+
+// The cyclic order of a round robin ready queue, for jumping over many
+// slices at once. Items are process indices in dispatch order by rank
+// 0..count-1; a pass of the dispatcher takes them in rank order, then
+// starts again at rank 0. Each item carries the pass in which it finishes,
+// and the first item to finish is the leftmost one with the smallest.
+// Insert, remove, rank lookup and that query are O(log n) in an implicit
+// treap whose nodes are the process indices themselves, so nothing is
+// allocated after rr_cycle_init.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    int *left;
+    int *right;
+    int *size;              // items in the subtree
+    unsigned *priority;     // heap order, random
+    long long *finish;      // the pass in which the item finishes
+    long long *minFinish;   // smallest finish in the subtree
+    int root;               // -1: empty
+    unsigned seed;
+} rr_cycle;
+
+static inline void rr_cycle_init(rr_cycle *c, int capacity) {
+    size_t items = capacity > 0 ? (size_t)capacity : 1;
+    c->left = (int *)malloc(items * sizeof(int));
+    c->right = (int *)malloc(items * sizeof(int));
+    c->size = (int *)malloc(items * sizeof(int));
+    c->priority = (unsigned *)malloc(items * sizeof(unsigned));
+    c->finish = (long long *)malloc(items * sizeof(long long));
+    c->minFinish = (long long *)malloc(items * sizeof(long long));
+    if (c->left == NULL || c->right == NULL || c->size == NULL || c->priority == NULL ||
+        c->finish == NULL || c->minFinish == NULL) {
+        printf("Out of memory for a round robin cycle of %d\n", capacity);
+        exit(EXIT_FAILURE);
+    }
+    c->root = -1;
+    c->seed = 2463534242u;
+}
+
+static inline void rr_cycle_free(rr_cycle *c) {
+    free(c->left);
+    free(c->right);
+    free(c->size);
+    free(c->priority);
+    free(c->finish);
+    free(c->minFinish);
+    c->left = c->right = c->size = NULL;
+    c->priority = NULL;
+    c->finish = c->minFinish = NULL;
+}
+
+static inline int rr_cycle_size_of(const rr_cycle *c, int t) {
+    return t < 0 ? 0 : c->size[t];
+}
+
+static inline int rr_cycle_count(const rr_cycle *c) {
+    return rr_cycle_size_of(c, c->root);
+}
+
+static inline void rr_cycle_update(rr_cycle *c, int t) {
+    int l = c->left[t], r = c->right[t];
+    long long m = c->finish[t];
+    if (l >= 0 && c->minFinish[l] < m) m = c->minFinish[l];
+    if (r >= 0 && c->minFinish[r] < m) m = c->minFinish[r];
+    c->size[t] = 1 + rr_cycle_size_of(c, l) + rr_cycle_size_of(c, r);
+    c->minFinish[t] = m;
+}
+
+// Split t into its first k items (*a) and the rest (*b)
+static inline void rr_cycle_split(rr_cycle *c, int t, int k, int *a, int *b) {
+    if (t < 0) {
+        *a = *b = -1;
+        return;
+    }
+    int leftSize = rr_cycle_size_of(c, c->left[t]);
+    if (k <= leftSize) {
+        rr_cycle_split(c, c->left[t], k, a, &c->left[t]);
+        *b = t;
+    } else {
+        rr_cycle_split(c, c->right[t], k - leftSize - 1, &c->right[t], b);
+        *a = t;
+    }
+    rr_cycle_update(c, t);
+}
+
+// All of a, then all of b
+static inline int rr_cycle_merge(rr_cycle *c, int a, int b) {
+    if (a < 0) return b;
+    if (b < 0) return a;
+    if (c->priority[a] > c->priority[b]) {
+        c->right[a] = rr_cycle_merge(c, c->right[a], b);
+        rr_cycle_update(c, a);
+        return a;
+    }
+    c->left[b] = rr_cycle_merge(c, a, c->left[b]);
+    rr_cycle_update(c, b);
+    return b;
+}
+
+// Put item at rank, 0 <= rank <= count; later items move up one
+static inline void rr_cycle_insert(rr_cycle *c, int rank, int item, long long finish) {
+    c->seed ^= c->seed << 13;
+    c->seed ^= c->seed >> 17;
+    c->seed ^= c->seed << 5;
+    c->left[item] = c->right[item] = -1;
+    c->priority[item] = c->seed;
+    c->finish[item] = finish;
+    rr_cycle_update(c, item);
+    int a, b;
+    rr_cycle_split(c, c->root, rank, &a, &b);
+    c->root = rr_cycle_merge(c, rr_cycle_merge(c, a, item), b);
+}
+
+// Take out the item at rank and return it; later items move down one
+static inline int rr_cycle_remove(rr_cycle *c, int rank) {
+    int a, item, b;
+    rr_cycle_split(c, c->root, rank, &a, &b);
+    rr_cycle_split(c, b, 1, &item, &b);
+    c->root = rr_cycle_merge(c, a, b);
+    return item;
+}
+
+// The item at rank, 0 <= rank < count
+static inline int rr_cycle_at(const rr_cycle *c, int rank) {
+    int t = c->root;
+    for (;;) {
+        int leftSize = rr_cycle_size_of(c, c->left[t]);
+        if (rank == leftSize) return t;
+        if (rank < leftSize) {
+            t = c->left[t];
+        } else {
+            rank -= leftSize + 1;
+            t = c->right[t];
+        }
+    }
+}
+
+// The lowest-ranked item with the smallest finish, and its rank in *rank.
+// The cycle must not be empty.
+static inline int rr_cycle_first_finish(const rr_cycle *c, int *rank) {
+    int t = c->root;
+    long long m = c->minFinish[t];
+    *rank = 0;
+    for (;;) {
+        int l = c->left[t];
+        if (l >= 0 && c->minFinish[l] == m) {
+            t = l;
+            continue;
+        }
+        *rank += rr_cycle_size_of(c, l);
+        if (c->finish[t] == m) return t;
+        *rank += 1;
+        t = c->right[t];
+    }
+}
+
+#endif
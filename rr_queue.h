@@ -0,0 +1,70 @@
+#ifndef RR_QUEUE_H
+#define RR_QUEUE_H
+
+// FIFO of process indices in a ring buffer, for round robin ready queues.
+// Push and pop are O(1). A queue that holds each process at most once
+// never needs more than one slot per process; one started smaller doubles
+// when it fills up (amortized O(1)).
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    int *slots;
+    int capacity;
+    int head;       // slot of the oldest item
+    int count;
+} rr_queue;
+
+static inline void rr_queue_init(rr_queue *q, int capacity) {
+    q->slots = (int *)malloc((capacity > 0 ? capacity : 1) * sizeof(int));
+    if (q->slots == NULL) {
+        printf("Out of memory for a ready queue of %d\n", capacity);
+        exit(EXIT_FAILURE);
+    }
+    q->capacity = capacity;
+    q->head = 0;
+    q->count = 0;
+}
+
+static inline void rr_queue_free(rr_queue *q) {
+    free(q->slots);
+    q->slots = NULL;
+}
+
+static inline void rr_queue_grow(rr_queue *q) {
+    int capacity = q->capacity > 0 ? 2 * q->capacity : 16;
+    int *slots = (int *)realloc(q->slots, capacity * sizeof(int));
+    if (slots == NULL) {
+        printf("Out of memory for a ready queue of %d\n", capacity);
+        exit(EXIT_FAILURE);
+    }
+    // Unwrap: items that wrapped around to the front move past the old end
+    int wrapped = q->head + q->count - q->capacity;
+    for (int i = 0; i < wrapped; i++) slots[q->capacity + i] = slots[i];
+    q->slots = slots;
+    q->capacity = capacity;
+}
+
+static inline void rr_push(rr_queue *q, int item) {
+    if (q->count == q->capacity) rr_queue_grow(q);
+    int tail = q->head + q->count++;
+    if (tail >= q->capacity) tail -= q->capacity;
+    q->slots[tail] = item;
+}
+
+static inline int rr_pop(rr_queue *q) {
+    int item = q->slots[q->head];
+    if (++q->head == q->capacity) q->head = 0;
+    q->count--;
+    return item;
+}
+
+// The i-th item from the head, 0 <= i < count
+static inline int rr_at(const rr_queue *q, int i) {
+    int slot = q->head + i;
+    if (slot >= q->capacity) slot -= q->capacity;
+    return q->slots[slot];
+}
+
+#endif
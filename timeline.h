@@ -0,0 +1,260 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+// Run-length-encoded Gantt timeline shared by Round_robin.c and cfs.c
+// (writers) and timeline_query.c (reader).
+//
+// A timeline is the list of CPU runs in time order, each a (start, length,
+// pid) record. Consecutive runs of the same process with no gap between
+// them are merged into one record, so a process running for 10,000 ticks
+// in one-tick slices costs 16 bytes, not 10,000 lines of text. Records go
+// out through a 1 MB buffer, as binary or as CSV. Idle time and context
+// switch time are the gaps between records.
+//
+// A binary file is a timeline_header, the records, a pid index, then the
+// run lists. The index has one timeline_index_entry per process, sorted by
+// pid, with the first and last of its records and where its run list
+// starts; a run list is the numbers of that process's records, in time
+// order, and the lists are stored one after another in pid order. Records
+// are sorted by start and never overlap, so a time window is a binary
+// search away, and one process's records are its run list, so neither
+// query reads records it does not print. The writer keeps the pid of every
+// record (4 bytes each) to build the lists on close, when the header's
+// counts and offsets are filled in too. Everything is in the host's byte
+// order; the header's magic and record_size catch a mismatched reader.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define TIMELINE_MAGIC "GANTTRLE"
+#define TIMELINE_VERSION 2
+#define TIMELINE_BUFFER_BYTES (1 << 20)
+#define TIMELINE_NONE UINT64_MAX    // index: process has no records
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t records;
+    uint64_t index_offset;          // bytes from the start of the file
+    uint64_t index_entries;
+    uint64_t list_offset;           // run lists: index_entries lists of uint64_t
+} timeline_header;
+
+typedef struct {
+    uint64_t start;
+    uint32_t length;
+    int32_t pid;
+} timeline_record;
+
+typedef struct {
+    int32_t pid;
+    uint32_t unused;
+    uint64_t first;                 // record numbers, counting from 0
+    uint64_t last;
+    uint64_t runs;                  // records of this process
+    uint64_t list;                  // its run list: entries from list_offset
+} timeline_index_entry;
+
+typedef struct {
+    FILE *out;
+    int csv;
+    char *buffer;
+    size_t used;
+    timeline_record pending;        // the run being extended, if has_pending
+    int has_pending;
+    uint64_t records;
+    // First and last record and number of records of every pid seen,
+    // indexed by pid, and the pid of every record (binary only)
+    uint64_t *first;
+    uint64_t *last;
+    uint64_t *runs;
+    long pids;
+    int32_t *record_pid;
+    uint64_t record_capacity;
+} timeline_writer;
+
+static inline void timeline_out_of_memory(void) {
+    printf("Out of memory for the timeline index\n");
+    exit(EXIT_FAILURE);
+}
+
+static inline void timeline_write_error(void) {
+    printf("Error writing the timeline file\n");
+    exit(EXIT_FAILURE);
+}
+
+// Open path for writing, binary or (csv != 0) as "start,length,pid" lines
+static inline void timeline_open(timeline_writer *w, const char *path, int csv) {
+    memset(w, 0, sizeof(*w));
+    w->csv = csv;
+    w->out = fopen(path, csv ? "w" : "wb");
+    w->buffer = (char *)malloc(TIMELINE_BUFFER_BYTES);
+    if (w->out == NULL || w->buffer == NULL) {
+        printf("Cannot open timeline file '%s'\n", path);
+        exit(EXIT_FAILURE);
+    }
+    if (csv) {
+        w->used = (size_t)sprintf(w->buffer, "start,length,pid\n");
+    } else {
+        timeline_header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, TIMELINE_MAGIC, sizeof(header.magic));
+        header.version = TIMELINE_VERSION;
+        header.record_size = sizeof(timeline_record);
+        memcpy(w->buffer, &header, sizeof(header));
+        w->used = sizeof(header);
+    }
+}
+
+static inline void timeline_flush(timeline_writer *w) {
+    if (w->used > 0 && fwrite(w->buffer, 1, w->used, w->out) != w->used) timeline_write_error();
+    w->used = 0;
+}
+
+static inline void timeline_note_pid(timeline_writer *w, int32_t pid) {
+    if (w->records >= w->record_capacity) {
+        w->record_capacity = w->record_capacity ? w->record_capacity * 2 : 4096;
+        w->record_pid = (int32_t *)realloc(w->record_pid, w->record_capacity * sizeof(int32_t));
+        if (w->record_pid == NULL) timeline_out_of_memory();
+    }
+    w->record_pid[w->records] = pid;
+    if (pid < 0) return;
+    if (pid >= w->pids) {
+        long pids = w->pids ? w->pids : 1024;
+        while (pids <= pid) pids *= 2;
+        w->first = (uint64_t *)realloc(w->first, pids * sizeof(uint64_t));
+        w->last = (uint64_t *)realloc(w->last, pids * sizeof(uint64_t));
+        w->runs = (uint64_t *)realloc(w->runs, pids * sizeof(uint64_t));
+        if (w->first == NULL || w->last == NULL || w->runs == NULL) timeline_out_of_memory();
+        for (long p = w->pids; p < pids; p++) {
+            w->first[p] = w->last[p] = TIMELINE_NONE;
+            w->runs[p] = 0;
+        }
+        w->pids = pids;
+    }
+    if (w->first[pid] == TIMELINE_NONE) w->first[pid] = w->records;
+    w->last[pid] = w->records;
+    w->runs[pid]++;
+}
+
+// Decimal digits of v at out, followed by end; returns the next free byte.
+// Much cheaper than sprintf, which would dominate a CSV export.
+static inline char *timeline_put_u64(char *out, uint64_t v, char end) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+    while (n > 0) *out++ = digits[--n];
+    *out++ = end;
+    return out;
+}
+
+// Append one finished record to the buffer
+static inline void timeline_emit(timeline_writer *w, const timeline_record *r) {
+    if (w->used + 64 > TIMELINE_BUFFER_BYTES) timeline_flush(w);
+    if (w->csv) {
+        char *out = w->buffer + w->used;
+        out = timeline_put_u64(out, r->start, ',');
+        out = timeline_put_u64(out, r->length, ',');
+        if (r->pid < 0) *out++ = '-';
+        out = timeline_put_u64(out, (uint64_t)(r->pid < 0 ? -(int64_t)r->pid : r->pid), '\n');
+        w->used = (size_t)(out - w->buffer);
+    } else {
+        timeline_note_pid(w, r->pid);
+        memcpy(w->buffer + w->used, r, sizeof(*r));
+        w->used += sizeof(*r);
+    }
+    w->records++;
+}
+
+// Process pid ran for length ticks from start. Runs must come in time order.
+static inline void timeline_add(timeline_writer *w, uint64_t start, uint64_t length, int32_t pid) {
+    if (length == 0) return;
+    timeline_record *p = &w->pending;
+    if (w->has_pending && p->pid == pid && p->start + p->length == start &&
+        p->length + length <= UINT32_MAX) {
+        p->length += (uint32_t)length;
+        return;
+    }
+    if (w->has_pending) timeline_emit(w, p);
+    // A run longer than a record can hold is split
+    while (length > UINT32_MAX) {
+        timeline_record full = {start, UINT32_MAX, pid};
+        timeline_emit(w, &full);
+        start += UINT32_MAX;
+        length -= UINT32_MAX;
+    }
+    p->start = start;
+    p->length = (uint32_t)length;
+    p->pid = pid;
+    w->has_pending = 1;
+}
+
+static inline void timeline_put(timeline_writer *w, const void *data, size_t size) {
+    if (w->used + size > TIMELINE_BUFFER_BYTES) timeline_flush(w);
+    memcpy(w->buffer + w->used, data, size);
+    w->used += size;
+}
+
+// Write what is left, the pid index, the run lists and the final header.
+// Returns the number of records.
+static inline uint64_t timeline_close(timeline_writer *w) {
+    if (w->has_pending) timeline_emit(w, &w->pending);
+    w->has_pending = 0;
+    uint64_t records = w->records;
+
+    if (!w->csv) {
+        uint64_t entries = 0, listed = 0;
+        for (long p = 0; p < w->pids; p++) {
+            if (w->first[p] == TIMELINE_NONE) continue;
+            timeline_index_entry e = {(int32_t)p, 0, w->first[p], w->last[p], w->runs[p], listed};
+            timeline_put(w, &e, sizeof(e));
+            entries++;
+            listed += w->runs[p];
+        }
+
+        // Counting sort of the record numbers by pid: runs[p] becomes the
+        // next free slot of p's list
+        uint64_t *list = (uint64_t *)malloc((listed > 0 ? listed : 1) * sizeof(uint64_t));
+        if (list == NULL) timeline_out_of_memory();
+        uint64_t at = 0;
+        for (long p = 0; p < w->pids; p++) {
+            uint64_t runs = w->runs[p];
+            w->runs[p] = at;
+            at += runs;
+        }
+        for (uint64_t i = 0; i < records; i++)
+            if (w->record_pid[i] >= 0) list[w->runs[w->record_pid[i]]++] = i;
+        for (uint64_t i = 0; i < listed; i++) timeline_put(w, &list[i], sizeof(list[i]));
+        free(list);
+        timeline_flush(w);
+
+        timeline_header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, TIMELINE_MAGIC, sizeof(header.magic));
+        header.version = TIMELINE_VERSION;
+        header.record_size = sizeof(timeline_record);
+        header.records = records;
+        header.index_offset = sizeof(header) + records * sizeof(timeline_record);
+        header.index_entries = entries;
+        header.list_offset = header.index_offset + entries * sizeof(timeline_index_entry);
+        if (fseek(w->out, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, w->out) != 1)
+            timeline_write_error();
+    }
+    timeline_flush(w);
+    if (fclose(w->out) != 0) timeline_write_error();
+    free(w->buffer);
+    free(w->first);
+    free(w->last);
+    free(w->runs);
+    free(w->record_pid);
+    memset(w, 0, sizeof(*w));
+    return records;
+}
+
+#endif
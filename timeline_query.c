@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "timeline.h"
+
+// Prints the runs of a binary Gantt timeline written by
+// `./Round_robin ... --timeline FILE` or `./cfs ... --timeline FILE`, for a
+// window of time, one process, or both. A window is found by binary search
+// over the time-sorted records, and a process's runs by its run list at the
+// end of the file (binary searched the same way for a window), so a query
+// reads its O(log n) probes, the records it prints and at most one block
+// more. Runs that straddle the window's edges are cut to it.
+//
+// Usage: ./timeline_query FILE [--from TICK] [--to TICK] [--pid N] [--count]
+//        --count prints only the totals
+
+// Records read per fread: small at first, as a short window may end soon,
+// then doubling up to the maximum for long scans
+#define QUERY_FIRST_BLOCK_RECORDS 256
+#define QUERY_BLOCK_RECORDS 16384
+
+typedef struct {
+    FILE *in;
+    uint64_t records_read;
+} timeline_file;
+
+// The window and what matched so far
+typedef struct {
+    uint64_t from, to;
+    int count_only;
+    uint64_t matched, ticks;
+} timeline_query;
+
+static void read_at(timeline_file *f, uint64_t offset, void *out, size_t size) {
+    if (fseeko(f->in, (off_t)offset, SEEK_SET) != 0 || fread(out, size, 1, f->in) != 1) {
+        printf("Error reading the timeline file\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static timeline_record record_at(timeline_file *f, uint64_t i) {
+    timeline_record r;
+    read_at(f, sizeof(timeline_header) + i * sizeof(timeline_record), &r, sizeof(r));
+    f->records_read++;
+    return r;
+}
+
+// First record in [lo, hi) that ends after tick, or hi if none does.
+// Records never overlap, so their ends are sorted like their starts.
+static uint64_t first_ending_after(timeline_file *f, uint64_t lo, uint64_t hi, uint64_t tick) {
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        timeline_record r = record_at(f, mid);
+        if (r.start + r.length > tick) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
+}
+
+// Binary search of the pid index; returns 0 if the process never ran
+static int find_pid(timeline_file *f, const timeline_header *h, int32_t pid,
+                    timeline_index_entry *out) {
+    uint64_t lo = 0, hi = h->index_entries;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        read_at(f, h->index_offset + mid * sizeof(*out), out, sizeof(*out));
+        if (out->pid == pid) return 1;
+        if (out->pid < pid) lo = mid + 1;
+        else hi = mid;
+    }
+    return 0;
+}
+
+// Record number at position i of a process's run list
+static uint64_t list_at(timeline_file *f, const timeline_header *h,
+                        const timeline_index_entry *e, uint64_t i) {
+    uint64_t record;
+    read_at(f, h->list_offset + (e->list + i) * sizeof(record), &record, sizeof(record));
+    return record;
+}
+
+// Print r cut to the window, if any of it is inside. Returns 0 once r
+// starts at or after the window's end, as every later record does too.
+static int visit(timeline_query *q, const timeline_record *r) {
+    if (r->start >= q->to) return 0;
+    uint64_t start = r->start > q->from ? r->start : q->from;
+    uint64_t end = r->start + r->length < q->to ? r->start + r->length : q->to;
+    if (start < end) {
+        if (!q->count_only)
+            printf("Time %llu-%llu: P%d\n", (unsigned long long)start, (unsigned long long)end, r->pid);
+        q->matched++;
+        q->ticks += end - start;
+    }
+    return 1;
+}
+
+// Every record in [lo, hi), in blocks, until one starts after the window
+static void scan_records(timeline_file *f, timeline_query *q, uint64_t lo, uint64_t hi) {
+    timeline_record *block = (timeline_record *)malloc(QUERY_BLOCK_RECORDS * sizeof(timeline_record));
+    size_t block_records = QUERY_FIRST_BLOCK_RECORDS;
+    int done = 0;
+    if (lo < hi && fseeko(f->in, (off_t)(sizeof(timeline_header) + lo * sizeof(timeline_record)), SEEK_SET) != 0)
+        done = 1;
+    while (!done && lo < hi) {
+        size_t want = hi - lo < block_records ? (size_t)(hi - lo) : block_records;
+        size_t n = fread(block, sizeof(timeline_record), want, f->in);
+        if (n == 0) break;
+        if (block_records < QUERY_BLOCK_RECORDS) block_records *= 2;
+        f->records_read += n;
+        lo += n;
+        for (size_t i = 0; i < n && !done; i++) done = !visit(q, &block[i]);
+    }
+    free(block);
+}
+
+// Positions [lo, hi) of a process's run list. The list is read in blocks,
+// and each stretch of consecutive record numbers in it with one read.
+static void scan_list(timeline_file *f, const timeline_header *h, const timeline_index_entry *e,
+                      timeline_query *q, uint64_t lo, uint64_t hi) {
+    uint64_t *numbers = (uint64_t *)malloc(QUERY_BLOCK_RECORDS * sizeof(uint64_t));
+    timeline_record *block = (timeline_record *)malloc(QUERY_BLOCK_RECORDS * sizeof(timeline_record));
+    size_t block_records = QUERY_FIRST_BLOCK_RECORDS;
+    int done = 0;
+    while (!done && lo < hi) {
+        size_t n = hi - lo < block_records ? (size_t)(hi - lo) : block_records;
+        read_at(f, h->list_offset + (e->list + lo) * sizeof(uint64_t), numbers, n * sizeof(uint64_t));
+        if (block_records < QUERY_BLOCK_RECORDS) block_records *= 2;
+        lo += n;
+        for (size_t i = 0; i < n && !done; ) {
+            size_t run = 1;
+            while (i + run < n && numbers[i + run] == numbers[i] + run) run++;
+            read_at(f, sizeof(timeline_header) + numbers[i] * sizeof(timeline_record),
+                    block, run * sizeof(timeline_record));
+            f->records_read += run;
+            for (size_t j = 0; j < run && !done; j++) done = !visit(q, &block[j]);
+            i += run;
+        }
+    }
+    free(numbers);
+    free(block);
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t from = 0, to = UINT64_MAX;
+    long pid = -1;
+    int count_only = 0, ok = argc >= 2;
+    for (int i = 2; i < argc && ok; i++) {
+        if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) from = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) to = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--pid") == 0 && i + 1 < argc) ok = (pid = strtol(argv[++i], NULL, 10)) >= 0;
+        else if (strcmp(argv[i], "--count") == 0) count_only = 1;
+        else ok = 0;
+    }
+    if (!ok || from >= to) {
+        printf("Usage: %s FILE [--from TICK] [--to TICK] [--pid N] [--count]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    timeline_file f = {fopen(argv[1], "rb"), 0};
+    if (f.in == NULL) {
+        printf("Cannot open timeline file '%s'\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    timeline_header header;
+    if (fread(&header, sizeof(header), 1, f.in) != 1 ||
+        memcmp(header.magic, TIMELINE_MAGIC, sizeof(header.magic)) != 0) {
+        printf("'%s' is not a binary timeline file\n", argv[1]);
+        fclose(f.in);
+        return EXIT_FAILURE;
+    }
+    if (header.version != TIMELINE_VERSION || header.record_size != sizeof(timeline_record)) {
+        printf("Unsupported timeline version %u (record size %u)\n", header.version, header.record_size);
+        fclose(f.in);
+        return EXIT_FAILURE;
+    }
+
+    timeline_query q = {from, to, count_only, 0, 0};
+    if (pid < 0) {
+        uint64_t lo = from > 0 ? first_ending_after(&f, 0, header.records, from) : 0;
+        scan_records(&f, &q, lo, header.records);
+    } else {
+        // The process's run list holds its records in time order, so a
+        // window is a binary search over it too
+        timeline_index_entry entry;
+        if (find_pid(&f, &header, (int32_t)pid, &entry)) {
+            uint64_t lo = 0, hi = entry.runs;
+            while (from > 0 && lo < hi) {
+                uint64_t mid = lo + (hi - lo) / 2;
+                timeline_record r = record_at(&f, list_at(&f, &header, &entry, mid));
+                if (r.start + r.length > from) hi = mid;
+                else lo = mid + 1;
+            }
+            scan_list(&f, &header, &entry, &q, lo, entry.runs);
+        }
+    }
+    if (ferror(f.in)) printf("Error reading '%s'\n", argv[1]);
+
+    printf("\n%llu runs, %llu ticks on the CPU (read %llu of %llu records)\n",
+           (unsigned long long)q.matched, (unsigned long long)q.ticks,
+           (unsigned long long)f.records_read, (unsigned long long)header.records);
+    fclose(f.in);
+    return EXIT_SUCCESS;
+}
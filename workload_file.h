@@ -0,0 +1,104 @@
+#ifndef WORKLOAD_FILE_H
+#define WORKLOAD_FILE_H
+
+// Workload traces for the classic schedulers (Fcfs.c, ...): one process per
+// line as "arrival burst [priority]". Blank lines and everything after a #
+// are ignored. The file is mapped into memory and parsed in place, so a
+// trace of millions of processes costs no per-line stdio calls.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct {
+    const char *path;
+    const char *data;
+    size_t size;
+    size_t pos;
+    long line;
+} workload_reader;
+
+static inline void workload_open(workload_reader *r, const char *path) {
+    int fd = open(path, O_RDONLY);
+    struct stat sb;
+    if (fd < 0 || fstat(fd, &sb) != 0) {
+        printf("Cannot open workload file '%s'\n", path);
+        exit(EXIT_FAILURE);
+    }
+    r->path = path;
+    r->data = NULL;
+    r->size = (size_t)sb.st_size;
+    if (r->size > 0) {
+        void *map = mmap(NULL, r->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            printf("Cannot map workload file '%s'\n", path);
+            exit(EXIT_FAILURE);
+        }
+        madvise(map, r->size, MADV_SEQUENTIAL);
+        r->data = (const char *)map;
+    }
+    close(fd);
+    r->pos = 0;
+    r->line = 0;
+}
+
+static inline void workload_rewind(workload_reader *r) {
+    r->pos = 0;
+    r->line = 0;
+}
+
+static inline void workload_close(workload_reader *r) {
+    if (r->data != NULL) munmap((void *)r->data, r->size);
+    r->data = NULL;
+}
+
+static inline void workload_error(const workload_reader *r, const char *what) {
+    printf("%s:%ld: %s\n", r->path, r->line, what);
+    exit(EXIT_FAILURE);
+}
+
+// Parse an integer at pos; returns 0 if there is none on this line
+static inline int workload_int(workload_reader *r, int *value) {
+    const char *d = r->data;
+    size_t end = r->size;
+    while (r->pos < end && (d[r->pos] == ' ' || d[r->pos] == '\t' || d[r->pos] == '\r')) r->pos++;
+    if (r->pos == end || d[r->pos] == '\n' || d[r->pos] == '#') return 0;
+
+    int negative = 0;
+    if (d[r->pos] == '-') {
+        negative = 1;
+        r->pos++;
+    }
+    if (r->pos == end || d[r->pos] < '0' || d[r->pos] > '9') workload_error(r, "expected a number");
+    long long v = 0;
+    while (r->pos < end && d[r->pos] >= '0' && d[r->pos] <= '9') {
+        v = v * 10 + (d[r->pos++] - '0');
+        if (v > 2147483647LL) workload_error(r, "number out of range");
+    }
+    *value = negative ? (int)-v : (int)v;
+    return 1;
+}
+
+// Read the next process. Returns 1 and fills arrival, burst and priority
+// (0 when the line has none), or 0 at the end of the file.
+static inline int workload_next(workload_reader *r, int *arrival, int *burst, int *priority) {
+    while (r->pos < r->size) {
+        r->line++;
+        int found = workload_int(r, arrival);
+        if (found) {
+            if (!workload_int(r, burst)) workload_error(r, "expected \"arrival burst [priority]\"");
+            if (!workload_int(r, priority)) *priority = 0;
+            if (workload_int(r, priority)) workload_error(r, "too many numbers");
+        }
+        // Only a comment can be left: skip it and the line break
+        while (r->pos < r->size && r->data[r->pos] != '\n') r->pos++;
+        if (r->pos < r->size) r->pos++;
+        if (found) return 1;
+    }
+    return 0;
+}
+
+#endif